@@ -1,12 +1,54 @@
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include <vector>
 #include <stack>
 #include <cstdlib>
 #include <ctime>
 #include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 
-// Maze Settings
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define MAZE_USE_SSE2 1
+#endif
+
+// Maze Settings (default size; MazeGenerator::Initialize takes others)
 const int MAZE_WIDTH = 20;
 const int MAZE_HEIGHT = 20;
 const float CELL_SIZE = 1.0f;
@@ -17,6 +59,7 @@ const float WALL_THICKNESS = 0.1f;
 const float PLAYER_HEIGHT = 0.5f;
 const float PLAYER_RADIUS = 0.15f;
 const float PLAYER_SPEED = 3.0f;
+const float CAPTURE_RADIUS = 0.35f;     // police this close to a bandit arrest it
 const float MOUSE_SENSITIVITY = 0.003f;
 const float CAMERA_HEIGHT = 0.4f;
 
@@ -24,6 +67,319 @@ const float CAMERA_HEIGHT = 0.4f;
 const int MINIMAP_SIZE = 150;
 const int MINIMAP_MARGIN = 10;
 
+// Frame Memory Settings
+const size_t FRAME_ARENA_BYTES = 256 * 1024;  // initial per-frame arena; grows if a frame overflows it
+const size_t LARGE_PAGE_BYTES = 2u << 20;     // x86-64 huge page
+const size_t LARGE_PAGE_THRESHOLD = 4u << 20; // LargePageAllocator maps blocks this big, the heap takes the rest
+
+// Counts raylib draw submissions (reported by the benchmark)
+struct RenderStats {
+    int drawCalls = 0;
+
+    void Reset() { drawCalls = 0; }
+};
+
+static RenderStats renderStats;
+
+// Counts heap allocations made through operator new, so the game can check
+// that steady-state frames make none (raylib's MemAlloc is not counted)
+static std::atomic<uint64_t> heapAllocations(0);
+
+// Subsystems that memory is charged to. Heap blocks take the tag of the
+// innermost MemoryScope on the allocating thread and give their bytes back
+// to that same tag when freed; raylib and GPU memory is charged explicitly.
+// The world-state arena and its snapshots count as NPCs, including the
+// cells of a maze bound to it
+enum class MemoryTag : uint8_t { OTHER, MAZE, NPCS, MESHES, TEXTURES, NAV, NETWORK, COUNT };
+const int MEMORY_TAG_COUNT = (int)MemoryTag::COUNT;
+const char* const MEMORY_TAG_NAMES[MEMORY_TAG_COUNT] = {"other", "maze", "npcs", "meshes", "textures", "nav",
+                                                         "network"};
+
+struct MemoryAccount {
+    std::atomic<int64_t> liveBytes{0};
+    std::atomic<int64_t> peakBytes{0};
+    std::atomic<uint64_t> allocations{0};
+};
+
+static MemoryAccount memoryAccounts[MEMORY_TAG_COUNT];
+static thread_local MemoryTag memoryTag = MemoryTag::OTHER;
+
+// Charges (or with negative bytes, refunds) live bytes to a tag
+void TrackMemory(MemoryTag tag, int64_t bytes) {
+    MemoryAccount& account = memoryAccounts[(int)tag];
+    int64_t live = account.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = account.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !account.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+}
+
+// Charges the heap allocations made while it is alive to `tag`
+class MemoryScope {
+private:
+    MemoryTag previous;
+
+public:
+    explicit MemoryScope(MemoryTag tag) : previous(memoryTag) { memoryTag = tag; }
+    ~MemoryScope() { memoryTag = previous; }
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+};
+
+// Every operator new block starts with this header, `offset` bytes before
+// the pointer handed out (more than its size for over-aligned blocks)
+struct AllocationHeader {
+    uint64_t size;
+    uint32_t offset;
+    MemoryTag tag;
+};
+const size_t ALLOCATION_HEADER_BYTES = 16;
+static_assert(sizeof(AllocationHeader) <= ALLOCATION_HEADER_BYTES, "header must fit its slot");
+
+static void* TrackedAllocate(void* base, size_t size, size_t offset) {
+    unsigned char* memory = (unsigned char*)base + offset;
+    AllocationHeader* header = (AllocationHeader*)(memory - ALLOCATION_HEADER_BYTES);
+    header->size = size;
+    header->offset = (uint32_t)offset;
+    header->tag = memoryTag;
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    memoryAccounts[(int)header->tag].allocations.fetch_add(1, std::memory_order_relaxed);
+    TrackMemory(header->tag, (int64_t)size);
+    return memory;
+}
+
+static void TrackedFree(void* memory) {
+    if (!memory) return;
+    const AllocationHeader* header = (const AllocationHeader*)((unsigned char*)memory - ALLOCATION_HEADER_BYTES);
+    TrackMemory(header->tag, -(int64_t)header->size);
+    free((unsigned char*)memory - header->offset);
+}
+
+// Kept out of line: GCC otherwise sees malloc paired with delete and warns
+#if defined(__GNUC__)
+#define MAZE_NOINLINE __attribute__((noinline))
+#else
+#define MAZE_NOINLINE
+#endif
+
+MAZE_NOINLINE void* operator new(size_t size) {
+    if (void* base = malloc(size + ALLOCATION_HEADER_BYTES)) {
+        return TrackedAllocate(base, size, ALLOCATION_HEADER_BYTES);
+    }
+    throw std::bad_alloc();
+}
+
+MAZE_NOINLINE void* operator new(size_t size, std::align_val_t align) {
+    size_t offset = std::max(ALLOCATION_HEADER_BYTES, (size_t)align);
+    void* base = nullptr;
+    if (posix_memalign(&base, std::max(sizeof(void*), (size_t)align), size + offset) == 0) {
+        return TrackedAllocate(base, size, offset);
+    }
+    throw std::bad_alloc();
+}
+
+MAZE_NOINLINE void operator delete(void* memory) noexcept { TrackedFree(memory); }
+MAZE_NOINLINE void operator delete(void* memory, size_t) noexcept { TrackedFree(memory); }
+MAZE_NOINLINE void operator delete(void* memory, std::align_val_t) noexcept { TrackedFree(memory); }
+MAZE_NOINLINE void operator delete(void* memory, size_t, std::align_val_t) noexcept { TrackedFree(memory); }
+
+// Live, peak and allocation count of every tag
+void PrintMemoryReport(FILE* out) {
+    int64_t live = 0;
+    uint64_t allocations = 0;
+    fprintf(out, "Memory by subsystem (live / peak, allocations):\n");
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        const MemoryAccount& account = memoryAccounts[tag];
+        live += account.liveBytes.load(std::memory_order_relaxed);
+        allocations += account.allocations.load(std::memory_order_relaxed);
+        fprintf(out, "  %-9s %10.1f KB / %10.1f KB, %llu\n", MEMORY_TAG_NAMES[tag],
+                account.liveBytes.load(std::memory_order_relaxed) / 1024.0,
+                account.peakBytes.load(std::memory_order_relaxed) / 1024.0,
+                (unsigned long long)account.allocations.load(std::memory_order_relaxed));
+    }
+    fprintf(out, "  total     %10.1f KB live, %llu allocations\n", live / 1024.0, (unsigned long long)allocations);
+}
+
+// Bump allocator for data that only lives for one frame. Everything is
+// released at once by Reset; a frame that outgrows the block spills into
+// overflow blocks, and the next Reset folds them into one larger block
+class FrameArena {
+private:
+    std::vector<unsigned char> block;
+    std::vector<std::vector<unsigned char>> overflow;
+    size_t used = 0;
+    size_t frameBytes = 0;
+    size_t lastFrameBytes = 0;
+    size_t peakBytes = 0;
+
+    static size_t Padding(const unsigned char* at, size_t align) {
+        return (align - (uintptr_t)at % align) % align;
+    }
+
+public:
+    explicit FrameArena(size_t capacity = FRAME_ARENA_BYTES) : block(capacity) {}
+
+    void* Allocate(size_t size, size_t align) {
+        size_t padding = Padding(block.data() + used, align);
+        frameBytes += size;
+        if (used + padding + size <= block.size()) {
+            void* memory = block.data() + used + padding;
+            used += padding + size;
+            return memory;
+        }
+        overflow.emplace_back(size + align);
+        unsigned char* start = overflow.back().data();
+        return start + Padding(start, align);
+    }
+
+    // Called once at the top of each frame; nothing handed out before stays valid
+    void Reset() {
+        lastFrameBytes = frameBytes;
+        peakBytes = std::max(peakBytes, frameBytes);
+        if (!overflow.empty()) {
+            overflow.clear();
+            block.assign(std::max(block.size() * 2, peakBytes + peakBytes / 2), 0);
+        }
+        used = 0;
+        frameBytes = 0;
+    }
+
+    size_t Capacity() const { return block.size(); }
+    size_t LastFrameBytes() const { return lastFrameBytes; }
+    size_t PeakBytes() const { return peakBytes; }
+};
+
+// STL allocator over a FrameArena; without an arena it falls back to the heap
+template<typename T>
+struct FrameAllocator {
+    using value_type = T;
+    FrameArena* arena = nullptr;
+
+    FrameAllocator(FrameArena* arena = nullptr) noexcept : arena(arena) {}
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        if (!arena) return static_cast<T*>(::operator new(count * sizeof(T)));
+        return static_cast<T*>(arena->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* memory, size_t) noexcept {
+        if (!arena) ::operator delete(memory);
+    }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const { return arena == other.arena; }
+    template<typename U>
+    bool operator!=(const FrameAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// How LargePageAllocator backs big blocks (--huge-pages)
+enum class LargePages { OFF, TRANSPARENT, EXPLICIT };
+
+struct LargePagePolicy {
+    LargePages mode = LargePages::TRANSPARENT;
+    // Touches each fresh block before use. The kernel puts a page on the NUMA
+    // node of the thread that first touches it, so touching from a worker
+    // pool spreads a block across the pool's nodes; when empty, the first
+    // writer places every page
+    std::function<void(unsigned char*, size_t)> spread;
+};
+
+static LargePagePolicy largePagePolicy;
+static std::atomic<uint64_t> hugetlbBlocks(0);     // blocks MapLargeBlock got on hugetlbfs pages
+
+#ifdef __linux__
+// Maps `mapped` bytes (a whole number of large pages) on a large page
+// boundary: hugetlbfs pages when EXPLICIT and the system has some reserved,
+// otherwise ordinary pages advised for transparent huge pages
+static void* MapLargeBlock(size_t mapped) {
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (largePagePolicy.mode == LargePages::EXPLICIT) {
+        memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        static std::atomic<bool> warned(false);
+        if (memory != MAP_FAILED) hugetlbBlocks.fetch_add(1, std::memory_order_relaxed);
+        else if (!warned.exchange(true)) {
+            TraceLog(LOG_WARNING, "MEM: No huge pages reserved (vm.nr_hugepages), using transparent ones");
+        }
+    }
+#endif
+    if (memory == MAP_FAILED) {
+        // One large page extra, trimmed off the ends, aligns the block
+        unsigned char* raw = (unsigned char*)mmap(nullptr, mapped + LARGE_PAGE_BYTES, PROT_READ | PROT_WRITE,
+                                                  flags, -1, 0);
+        if (raw == MAP_FAILED) return nullptr;
+        size_t head = (LARGE_PAGE_BYTES - (uintptr_t)raw % LARGE_PAGE_BYTES) % LARGE_PAGE_BYTES;
+        if (head) munmap(raw, head);
+        munmap(raw + head + mapped, LARGE_PAGE_BYTES - head);
+        memory = raw + head;
+#ifdef MADV_HUGEPAGE
+        // OFF opts out too, so it measures small pages even with THP set to "always"
+        madvise(memory, mapped, largePagePolicy.mode == LargePages::OFF ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+#endif
+    }
+    if (largePagePolicy.spread) largePagePolicy.spread((unsigned char*)memory, mapped);
+    return memory;
+}
+#endif
+
+// STL allocator for per-cell grids of huge mazes. Blocks of
+// LARGE_PAGE_THRESHOLD bytes or more are mapped directly on large pages,
+// which take far fewer TLB entries under random access; smaller ones come
+// from the heap. Everything is charged to TAG
+template<typename T, MemoryTag TAG>
+struct LargePageAllocator {
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    template<typename U>
+    struct rebind { using other = LargePageAllocator<U, TAG>; };
+
+    LargePageAllocator() noexcept = default;
+    template<typename U>
+    LargePageAllocator(const LargePageAllocator<U, TAG>&) noexcept {}
+
+    static size_t Mapped(size_t count) {
+        return (count * sizeof(T) + LARGE_PAGE_BYTES - 1) / LARGE_PAGE_BYTES * LARGE_PAGE_BYTES;
+    }
+
+    T* allocate(size_t count) {
+#ifdef __linux__
+        if (count * sizeof(T) >= LARGE_PAGE_THRESHOLD) {
+            void* memory = MapLargeBlock(Mapped(count));
+            if (!memory) throw std::bad_alloc();
+            heapAllocations.fetch_add(1, std::memory_order_relaxed);
+            memoryAccounts[(int)TAG].allocations.fetch_add(1, std::memory_order_relaxed);
+            TrackMemory(TAG, (int64_t)Mapped(count));
+            return static_cast<T*>(memory);
+        }
+#endif
+        MemoryScope scope(TAG);
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* memory, size_t count) noexcept {
+#ifdef __linux__
+        if (count * sizeof(T) >= LARGE_PAGE_THRESHOLD) {
+            munmap(memory, Mapped(count));
+            TrackMemory(TAG, -(int64_t)Mapped(count));
+            return;
+        }
+#endif
+        ::operator delete(memory);
+    }
+
+    template<typename U>
+    bool operator==(const LargePageAllocator<U, TAG>&) const { return true; }
+    template<typename U>
+    bool operator!=(const LargePageAllocator<U, TAG>&) const { return false; }
+};
+
+template<typename T, MemoryTag TAG>
+using LargeVector = std::vector<T, LargePageAllocator<T, TAG>>;
+
 struct Cell {
     int x, y;
     bool visited = false;
@@ -32,6 +388,264 @@ struct Cell {
     Cell(int x = 0, int y = 0) : x(x), y(y) {}
 };
 
+// Small deterministic RNG (xorshift64*). Each maze owns one, so worlds
+// simulated on different threads stay reproducible from their seed.
+struct Rng {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+
+    void Seed(uint64_t seed) {
+        state = (seed + 1) * 0x9E3779B97F4A7C15ull;
+        if (state == 0) state = 1;
+    }
+
+    uint32_t Next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    int Range(int n) { return (int)(Next() % (uint32_t)n); }
+};
+
+// Neighbour offsets matching Cell::walls order (Top, Right, Bottom, Left)
+const int SIDE_DX[4] = {0, 1, 0, -1};
+const int SIDE_DY[4] = {1, 0, -1, 0};
+
+// Atlas Settings
+const int ATLAS_SIZE = 512;
+const int ATLAS_SLOT_SIZE = 256;    // 2x2 slots
+const int ATLAS_GUTTER = 16;        // wrapped border so mip levels don't bleed between slots
+const char* WALL_SKIN_FILE = "skin.jpeg";
+
+enum AtlasRegion { ATLAS_WALL, ATLAS_FLOOR, ATLAS_NPC, ATLAS_WHITE, ATLAS_REGION_COUNT };
+
+// One mipmapped texture holding every material, so textured geometry keeps the
+// draw-call count of the flat-colour path. Images are decoded and packed on a
+// worker thread at startup; until then everything samples the default white
+// texture. Skins are normalised to a bright average so they multiply with the
+// baked vertex colours without darkening the scene.
+class MaterialAtlas {
+private:
+    std::future<Image> pending;
+    Texture2D texture = {};
+    bool ready = false;
+
+    typedef std::vector<Color> Pixels;
+    static const int CONTENT_SIZE = ATLAS_SLOT_SIZE - 2 * ATLAS_GUTTER;
+
+    // RGBA8 plus the mip chain's extra third
+    static int64_t TextureBytes() { return (int64_t)ATLAS_SIZE * ATLAS_SIZE * sizeof(Color) * 4 / 3; }
+
+    static unsigned Hash(unsigned x, unsigned y) {
+        unsigned h = x * 374761393u + y * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return h ^ (h >> 16);
+    }
+
+    // Resample an image (or a crop of it) to CONTENT_SIZE squared
+    static Pixels Resample(const Color* source, int sourceWidth, int sourceHeight, int cropWidth, int cropHeight) {
+        Pixels pixels((size_t)CONTENT_SIZE * CONTENT_SIZE);
+        for (int y = 0; y < CONTENT_SIZE; y++) {
+            for (int x = 0; x < CONTENT_SIZE; x++) {
+                int sx = std::min(sourceWidth - 1, x * cropWidth / CONTENT_SIZE);
+                int sy = std::min(sourceHeight - 1, y * cropHeight / CONTENT_SIZE);
+                pixels[(size_t)y * CONTENT_SIZE + x] = source[(size_t)sy * sourceWidth + sx];
+            }
+        }
+        return pixels;
+    }
+
+    static void Normalize(Pixels& pixels, float targetLuminance) {
+        double sum = 0.0;
+        for (const Color& c : pixels) sum += 0.299 * c.r + 0.587 * c.g + 0.114 * c.b;
+        float mean = (float)(sum / pixels.size());
+        float gain = std::min(3.0f, targetLuminance / std::max(mean, 1.0f));
+        for (Color& c : pixels) {
+            c.r = (unsigned char)std::min(255.0f, c.r * gain);
+            c.g = (unsigned char)std::min(255.0f, c.g * gain);
+            c.b = (unsigned char)std::min(255.0f, c.b * gain);
+        }
+    }
+
+    static Pixels GenerateBricks() {
+        Pixels pixels((size_t)CONTENT_SIZE * CONTENT_SIZE);
+        const int brickHeight = CONTENT_SIZE / 8;
+        const int brickWidth = CONTENT_SIZE / 4;
+        for (int y = 0; y < CONTENT_SIZE; y++) {
+            for (int x = 0; x < CONTENT_SIZE; x++) {
+                int row = y / brickHeight;
+                int bx = (x + (row % 2) * brickWidth / 2) % brickWidth;
+                bool mortar = (y % brickHeight) < 3 || bx < 3;
+                unsigned char v = mortar ? 40 : (unsigned char)(200 + Hash(x / 4, y / 4) % 40);
+                pixels[(size_t)y * CONTENT_SIZE + x] = {v, v, v, 255};
+            }
+        }
+        return pixels;
+    }
+
+    static Pixels GenerateFloor() {
+        Pixels pixels((size_t)CONTENT_SIZE * CONTENT_SIZE);
+        for (int y = 0; y < CONTENT_SIZE; y++) {
+            for (int x = 0; x < CONTENT_SIZE; x++) {
+                unsigned char v = (unsigned char)(190 + (Hash(x, y) % 40) + (Hash(x / 8, y / 8) % 25));
+                pixels[(size_t)y * CONTENT_SIZE + x] = {v, v, v, 255};
+            }
+        }
+        return pixels;
+    }
+
+    // Striped bandit uniform; tinted per NPC by its colour
+    static Pixels GenerateNpcSkin() {
+        Pixels pixels((size_t)CONTENT_SIZE * CONTENT_SIZE);
+        for (int y = 0; y < CONTENT_SIZE; y++) {
+            unsigned char v = ((y / 28) % 2 == 0) ? 255 : 150;
+            for (int x = 0; x < CONTENT_SIZE; x++) {
+                pixels[(size_t)y * CONTENT_SIZE + x] = {v, v, v, 255};
+            }
+        }
+        return pixels;
+    }
+
+    static Pixels LoadWallSkin() {
+        Image image = LoadImage(WALL_SKIN_FILE);
+        if (image.data == nullptr) {
+            TraceLog(LOG_WARNING, "MAZE: Could not load %s, using generated bricks", WALL_SKIN_FILE);
+            return GenerateBricks();
+        }
+        ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        // A corner crop keeps bricks at a sensible size on one wall face
+        Pixels pixels = Resample((const Color*)image.data, image.width, image.height,
+                                 image.width * 2 / 5, image.height * 2 / 5);
+        UnloadImage(image);
+        Normalize(pixels, 235.0f);
+        return pixels;
+    }
+
+    // Runs on the loader thread: decode, generate and pack into one image
+    static Image BuildImage() {
+        MemoryScope scope(MemoryTag::TEXTURES);
+        Pixels slots[ATLAS_REGION_COUNT];
+        slots[ATLAS_WALL] = LoadWallSkin();
+        slots[ATLAS_FLOOR] = GenerateFloor();
+        slots[ATLAS_NPC] = GenerateNpcSkin();
+        slots[ATLAS_WHITE].assign((size_t)CONTENT_SIZE * CONTENT_SIZE, WHITE);
+
+        Image atlas = {};
+        atlas.width = ATLAS_SIZE;
+        atlas.height = ATLAS_SIZE;
+        atlas.mipmaps = 1;
+        atlas.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        atlas.data = MemAlloc(ATLAS_SIZE * ATLAS_SIZE * sizeof(Color));
+        Color* out = (Color*)atlas.data;
+
+        for (int region = 0; region < ATLAS_REGION_COUNT; region++) {
+            int originX = (region % 2) * ATLAS_SLOT_SIZE;
+            int originY = (region / 2) * ATLAS_SLOT_SIZE;
+            for (int y = 0; y < ATLAS_SLOT_SIZE; y++) {
+                int sy = (y - ATLAS_GUTTER + CONTENT_SIZE) % CONTENT_SIZE;
+                for (int x = 0; x < ATLAS_SLOT_SIZE; x++) {
+                    int sx = (x - ATLAS_GUTTER + CONTENT_SIZE) % CONTENT_SIZE;
+                    out[(size_t)(originY + y) * ATLAS_SIZE + originX + x] = slots[region][(size_t)sy * CONTENT_SIZE + sx];
+                }
+            }
+        }
+        return atlas;
+    }
+
+public:
+    void BeginLoad() {
+        if (ready || pending.valid()) return;
+        pending = std::async(std::launch::async, &MaterialAtlas::BuildImage);
+    }
+
+    // Upload once the loader thread is done (GL calls stay on the main thread).
+    // Returns true while the atlas is usable.
+    bool Update(bool wait = false) {
+        if (ready || !pending.valid()) return ready;
+        if (!wait && pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        Image image = pending.get();
+        texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        GenTextureMipmaps(&texture);
+        SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+        SetTextureWrap(texture, TEXTURE_WRAP_CLAMP);
+        TrackMemory(MemoryTag::TEXTURES, TextureBytes());
+        ready = true;
+        return true;
+    }
+
+    void Unload() {
+        if (pending.valid()) UnloadImage(pending.get());
+        if (ready) {
+            UnloadTexture(texture);
+            TrackMemory(MemoryTag::TEXTURES, -TextureBytes());
+        }
+        texture = {};
+        ready = false;
+    }
+
+    bool IsReady() const { return ready; }
+
+    unsigned GetTextureId() const { return ready ? texture.id : rlGetTextureIdDefault(); }
+
+    // raylib's 1x1 default white texture until the upload is done
+    Texture2D GetTexture() const {
+        if (ready) return texture;
+        return {rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    }
+
+    // Normalised UV rectangle of a region's content (inside its gutter)
+    static Rectangle GetRegion(AtlasRegion region) {
+        const float scale = 1.0f / ATLAS_SIZE;
+        return {((region % 2) * ATLAS_SLOT_SIZE + ATLAS_GUTTER) * scale,
+                ((region / 2) * ATLAS_SLOT_SIZE + ATLAS_GUTTER) * scale,
+                CONTENT_SIZE * scale, CONTENT_SIZE * scale};
+    }
+};
+
+// Sphere through the rlgl batch with texture coordinates inside an atlas region.
+// The unit-sphere grid is computed once per ring/slice count.
+static void DrawAtlasSphere(Vector3 center, float radius, int rings, int slices, const MaterialAtlas& atlas,
+                            AtlasRegion region, Color color) {
+    static std::vector<Vector3> unitPoints;
+    static int cachedRings = 0;
+    static int cachedSlices = 0;
+    if (rings != cachedRings || slices != cachedSlices) {
+        unitPoints.clear();
+        for (int i = 0; i <= rings; i++) {
+            float theta = PI * i / rings;
+            for (int j = 0; j <= slices; j++) {
+                float phi = 2.0f * PI * j / slices;
+                unitPoints.push_back({sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)});
+            }
+        }
+        cachedRings = rings;
+        cachedSlices = slices;
+    }
+
+    Rectangle uv = MaterialAtlas::GetRegion(region);
+    rlCheckRenderBatchLimit(rings * slices * 6);
+    rlSetTexture(atlas.GetTextureId());
+    rlBegin(RL_TRIANGLES);
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    auto vertex = [&](int i, int j) {
+        const Vector3& p = unitPoints[(size_t)i * (slices + 1) + j];
+        rlTexCoord2f(uv.x + uv.width * j / slices, uv.y + uv.height * i / rings);
+        rlVertex3f(center.x + radius * p.x, center.y + radius * p.y, center.z + radius * p.z);
+    };
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < slices; j++) {
+            // Counter-clockwise seen from outside
+            vertex(i, j); vertex(i + 1, j + 1); vertex(i + 1, j);
+            vertex(i, j); vertex(i, j + 1); vertex(i + 1, j + 1);
+        }
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
 // Forward declaration
 class MazeGenerator;
 
@@ -40,6 +654,8 @@ struct NPC {
     Vector3 position;
     Vector3 target;
     float speed = 2.0f;  // Slower than player (player is 3.0f)
+    float fleeDistance = 3.0f;      // runs from a closer player
+    float chaseDistance = 5.0f;     // follows a player within this
     float thinkTimer = 0.0f;
     Color color;
     
@@ -48,43 +664,171 @@ struct NPC {
     
     void Think(MazeGenerator& maze, Vector3 playerPos, float deltaTime);
     void Update(MazeGenerator& maze, float deltaTime);
-    void Draw();
+    void Draw(const MaterialAtlas& atlas);
+    Color GetStateColor() const;
+};
+
+// Non-owning view of a contiguous NPC array (a std::vector or the world arena)
+struct NpcList {
+    NPC* data = nullptr;
+    size_t count = 0;
+
+    NpcList() = default;
+    NpcList(NPC* npcs, size_t npcCount) : data(npcs), count(npcCount) {}
+    NpcList(std::vector<NPC>& npcs) : data(npcs.data()), count(npcs.size()) {}
+
+    NPC* begin() const { return data; }
+    NPC* end() const { return data + count; }
+    size_t size() const { return count; }
+    NPC& operator[](size_t i) const { return data[i]; }
+};
+
+// How a maze stores its cells. Cell indices used by pathfinding stay
+// x * height + y either way; only the memory order changes.
+enum class CellLayout {
+    COLUMN_MAJOR,   // (x, y) at x * height + y
+    TILED           // 8x8 tiles in column-major order, Morton (Z) order inside each
 };
+const int CELL_TILE_SHIFT = 3;
 
 class MazeGenerator {
 private:
-    Cell grid[MAZE_WIDTH][MAZE_HEIGHT];
+    int width = MAZE_WIDTH;
+    int height = MAZE_HEIGHT;
+    // Cells and RNG live here, or in a WorldState arena after Bind
+    LargeVector<Cell, MemoryTag::MAZE> ownedCells;
+    Rng ownedRng;
+    Cell* grid = nullptr;
+    Rng* rng = &ownedRng;
+    size_t boundCells = 0;
+    bool readOnly = false;      // grid shared with other generators
     std::stack<Cell*> pathStack;
+    CellLayout layout = CellLayout::COLUMN_MAJOR;   // for own storage
+    bool tiled = false;         // grid is tiled; bound and shared grids never are
+    bool ownedTiled = false;
+    int tilesY = 0;
+
+    // Spreads the low three bits of x and y over alternate bits
+    static unsigned Interleave(int x, int y) {
+        return (x & 1) | (y & 1) << 1 | (x & 2) << 1 | (y & 2) << 2 | (x & 4) << 2 | (y & 4) << 3;
+    }
+
+    // A tile is 64 cells (1 KB), so neighbours on either axis mostly share
+    // its cache lines and pages, where column-major puts x neighbours a
+    // whole column apart
+    size_t Slot(int x, int y) const {
+        if (!tiled) return (size_t)x * height + y;
+        size_t tile = (size_t)(x >> CELL_TILE_SHIFT) * tilesY + (y >> CELL_TILE_SHIFT);
+        return tile << (2 * CELL_TILE_SHIFT) | Interleave(x, y);
+    }
+
+    Cell& At(int x, int y) { return grid[Slot(x, y)]; }
 
 public:
-    void Initialize() {
-        for (int x = 0; x < MAZE_WIDTH; x++) {
-            for (int y = 0; y < MAZE_HEIGHT; y++) {
-                grid[x][y] = Cell(x, y);
+    MazeGenerator() = default;
+    MazeGenerator(const MazeGenerator&) = delete;
+    MazeGenerator& operator=(const MazeGenerator&) = delete;
+
+    // Use external storage for the cells and RNG (a WorldState arena), so
+    // saving that storage captures the maze and every later random decision
+    void Bind(Cell* cells, size_t cellCount, Rng* state) {
+        grid = cells;
+        boundCells = cellCount;
+        rng = state;
+        tiled = false;
+    }
+
+    // Walk an already generated grid that other generators share. It is
+    // never written: Initialize switches back to own storage first.
+    void BindShared(const Cell* cells, int mazeWidth, int mazeHeight) {
+        grid = const_cast<Cell*>(cells);
+        width = mazeWidth;
+        height = mazeHeight;
+        boundCells = 0;
+        readOnly = true;
+        tiled = false;
+    }
+
+    void Unbind() {
+        ownedRng = *rng;
+        rng = &ownedRng;
+        boundCells = 0;
+        readOnly = false;
+        grid = ownedCells.empty() ? nullptr : ownedCells.data();
+        tiled = ownedTiled;
+    }
+
+    // Layout of own storage from the next Initialize. Bound and shared
+    // grids are column-major, as WorldState and SharedMaze hold them.
+    void SetLayout(CellLayout cellLayout) { layout = cellLayout; }
+    CellLayout GetLayout() const { return tiled ? CellLayout::TILED : CellLayout::COLUMN_MAJOR; }
+
+    // Seeds generation, spawn points and NPC decisions for this maze
+    void Seed(uint64_t seed) { rng->Seed(seed); }
+
+    int Random(int n) { return rng->Range(n); }
+
+    // Bound storage must hold width * height cells
+    void Initialize(int mazeWidth = MAZE_WIDTH, int mazeHeight = MAZE_HEIGHT) {
+        MemoryScope scope(MemoryTag::MAZE);
+        width = mazeWidth;
+        height = mazeHeight;
+        if (boundCells != 0 && boundCells != (size_t)width * height) {
+            TraceLog(LOG_WARNING, "MAZE: %dx%d does not fit the bound world state, using own storage", width, height);
+            Unbind();
+        }
+        readOnly = false;
+        tiled = false;
+        if (boundCells == 0) {
+            // Tiled storage is padded out to whole tiles
+            tiled = ownedTiled = layout == CellLayout::TILED;
+            tilesY = (height + (1 << CELL_TILE_SHIFT) - 1) >> CELL_TILE_SHIFT;
+            int tilesX = (width + (1 << CELL_TILE_SHIFT) - 1) >> CELL_TILE_SHIFT;
+            ownedCells.resize(tiled ? ((size_t)tilesX * tilesY) << (2 * CELL_TILE_SHIFT) : (size_t)width * height);
+            grid = ownedCells.data();
+        }
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < height; y++) {
+                At(x, y) = Cell(x, y);
             }
         }
     }
 
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+    // Opens or closes the wall on `side` of (x, y) and the matching wall of
+    // the neighbour. The outer boundary stays closed.
+    bool SetWall(int x, int y, int side, bool closed) {
+        int nx = x + SIDE_DX[side];
+        int ny = y + SIDE_DY[side];
+        if (readOnly || !GetCell(x, y) || !GetCell(nx, ny)) return false;
+        At(x, y).walls[side] = closed;
+        At(nx, ny).walls[(side + 2) % 4] = closed;
+        return true;
+    }
+
     Cell* GetCell(int x, int y) {
-        if (x >= 0 && x < MAZE_WIDTH && y >= 0 && y < MAZE_HEIGHT)
-            return &grid[x][y];
+        if (x >= 0 && x < width && y >= 0 && y < height)
+            return &At(x, y);
         return nullptr;
     }
 
     Cell* GetUnvisitedNeighbour(Cell* current) {
-        std::vector<Cell*> neighbours;
-
-        if (current->y + 1 < MAZE_HEIGHT && !grid[current->x][current->y + 1].visited)
-            neighbours.push_back(&grid[current->x][current->y + 1]);
-        if (current->x + 1 < MAZE_WIDTH && !grid[current->x + 1][current->y].visited)
-            neighbours.push_back(&grid[current->x + 1][current->y]);
-        if (current->y - 1 >= 0 && !grid[current->x][current->y - 1].visited)
-            neighbours.push_back(&grid[current->x][current->y - 1]);
-        if (current->x - 1 >= 0 && !grid[current->x - 1][current->y].visited)
-            neighbours.push_back(&grid[current->x - 1][current->y]);
-
-        if (!neighbours.empty())
-            return neighbours[rand() % neighbours.size()];
+        Cell* neighbours[4];
+        int count = 0;
+
+        if (current->y + 1 < height && !At(current->x, current->y + 1).visited)
+            neighbours[count++] = &At(current->x, current->y + 1);
+        if (current->x + 1 < width && !At(current->x + 1, current->y).visited)
+            neighbours[count++] = &At(current->x + 1, current->y);
+        if (current->y - 1 >= 0 && !At(current->x, current->y - 1).visited)
+            neighbours[count++] = &At(current->x, current->y - 1);
+        if (current->x - 1 >= 0 && !At(current->x - 1, current->y).visited)
+            neighbours[count++] = &At(current->x - 1, current->y);
+
+        if (count > 0)
+            return neighbours[rng->Range(count)];
         return nullptr;
     }
 
@@ -112,7 +856,9 @@ public:
     }
 
     void Generate() {
-        Cell* current = &grid[0][0];
+        MemoryScope scope(MemoryTag::MAZE);
+        if (readOnly) return;
+        Cell* current = &At(0, 0);
         current->visited = true;
         pathStack.push(current);
 
@@ -132,8 +878,8 @@ public:
     }
 
     Vector3 GetRandomSpawnPosition() {
-        int x = rand() % MAZE_WIDTH;
-        int y = rand() % MAZE_HEIGHT;
+        int x = rng->Range(width);
+        int y = rng->Range(height);
         return {x * CELL_SIZE, PLAYER_HEIGHT / 2, y * CELL_SIZE};
     }
 
@@ -155,53 +901,19 @@ public:
         return false;
     }
 
-    void DrawWall(Vector3 position, bool rotated) {
-        Vector3 size;
-        if (rotated) {
-            size = {WALL_THICKNESS, WALL_HEIGHT, CELL_SIZE + WALL_THICKNESS};
-        } else {
-            size = {CELL_SIZE + WALL_THICKNESS, WALL_HEIGHT, WALL_THICKNESS};
-        }
-        
-        DrawCubeV(position, size, DARKGRAY);
-        DrawCubeWiresV(position, size, BLACK);
-    }
-
-    void Draw() {
-        for (int x = 0; x < MAZE_WIDTH; x++) {
-            for (int y = 0; y < MAZE_HEIGHT; y++) {
-                Cell& current = grid[x][y];
-                Vector3 pos = {x * CELL_SIZE, WALL_HEIGHT / 2, y * CELL_SIZE};
-
-                if (current.walls[0]) {
-                    DrawWall({pos.x, pos.y, pos.z + CELL_SIZE / 2}, false);
-                }
-                if (current.walls[1]) {
-                    DrawWall({pos.x + CELL_SIZE / 2, pos.y, pos.z}, true);
-                }
-                if (y == 0 && current.walls[2]) {
-                    DrawWall({pos.x, pos.y, pos.z - CELL_SIZE / 2}, false);
-                }
-                if (x == 0 && current.walls[3]) {
-                    DrawWall({pos.x - CELL_SIZE / 2, pos.y, pos.z}, true);
-                }
-            }
-        }
-    }
-
-    void DrawMinimap(int screenWidth, int screenHeight, Vector3 playerPos, float playerYaw, std::vector<NPC>& npcs) {
+    void DrawMinimap(int screenWidth, int screenHeight, Vector3 playerPos, float playerYaw, NpcList npcs) {
         int minimapX = screenWidth - MINIMAP_SIZE - MINIMAP_MARGIN;
         int minimapY = screenHeight - MINIMAP_SIZE - MINIMAP_MARGIN;
         
         // Semi-transparent background
         DrawRectangle(minimapX - 5, minimapY - 5, MINIMAP_SIZE + 10, MINIMAP_SIZE + 10, Fade(BLACK, 0.7f));
         
-        float cellPixelSize = (float)MINIMAP_SIZE / fmax(MAZE_WIDTH, MAZE_HEIGHT);
+        float cellPixelSize = (float)MINIMAP_SIZE / fmax(width, height);
         
         // Draw maze cells and walls
-        for (int x = 0; x < MAZE_WIDTH; x++) {
-            for (int y = 0; y < MAZE_HEIGHT; y++) {
-                Cell& current = grid[x][y];
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < height; y++) {
+                Cell& current = At(x, y);
                 
                 float pixelX = minimapX + x * cellPixelSize;
                 float pixelY = minimapY + y * cellPixelSize;
@@ -249,6 +961,135 @@ public:
     }
 };
 
+// Maze core with its size fixed at compile time, for the default 20x20
+// maze. Columns are padded to a power-of-two stride so a cell is
+// x << SHIFT | y, each side's walls are one std::bitset, and which sides
+// stay inside the maze is a table the compiler builds. With every bound a
+// constant, loops unroll and bounds checks fold away. MazeGenerator stays
+// the path for sizes chosen at run time; from the same seed both generate
+// the same maze.
+template <int W, int H>
+class FixedMaze {
+public:
+    static constexpr int SHIFT = [] {
+        int shift = 0;
+        while ((1 << shift) < H) shift++;
+        return shift;
+    }();
+    static constexpr int STRIDE = 1 << SHIFT;
+    static constexpr int CELLS = W * STRIDE;
+    static_assert(W > 0 && H > 0 && CELLS <= 1 << 15, "FixedMaze is for small mazes");
+
+    static constexpr int Index(int x, int y) { return x << SHIFT | y; }
+
+private:
+    static constexpr int STEP[4] = {1, STRIDE, -1, -STRIDE};   // index offset per side
+
+    // Per cell: bit `side` set when the neighbour that way is inside the maze
+    static constexpr std::array<uint8_t, CELLS> INSIDE = [] {
+        std::array<uint8_t, CELLS> inside = {};
+        for (int x = 0; x < W; x++) {
+            for (int y = 0; y < H; y++) {
+                inside[x << SHIFT | y] = (uint8_t)((y + 1 < H) | (x + 1 < W) << 1 | (y > 0) << 2 | (x > 0) << 3);
+            }
+        }
+        return inside;
+    }();
+
+    std::bitset<CELLS> walls[4];    // per side: set where that wall is closed
+
+public:
+    // The same depth-first backtracker as MazeGenerator::Generate, drawing
+    // the same numbers from `rng`
+    void Generate(Rng& rng) {
+        for (auto& side : walls) side.set();
+        std::bitset<CELLS> visited;
+        std::array<int16_t, CELLS> stack;
+        int top = 0;
+        int current = 0;
+        visited.set(current);
+        stack[top++] = (int16_t)current;
+        while (top > 0) {
+            int options[4];
+            int count = 0;
+            for (int side = 0; side < 4; side++) {
+                if ((INSIDE[current] >> side & 1) && !visited[current + STEP[side]]) options[count++] = side;
+            }
+            if (count > 0) {
+                int side = options[rng.Range(count)];
+                int next = current + STEP[side];
+                walls[side].reset(current);
+                walls[(side + 2) % 4].reset(next);
+                visited.set(next);
+                stack[top++] = (int16_t)current;
+                current = next;
+            }
+            else {
+                current = stack[--top];
+            }
+        }
+    }
+
+    // Takes the walls of a runtime maze of the same size
+    bool CopyFrom(MazeGenerator& maze) {
+        if (maze.GetWidth() != W || maze.GetHeight() != H) return false;
+        for (int x = 0; x < W; x++) {
+            for (int y = 0; y < H; y++) {
+                const Cell* cell = maze.GetCell(x, y);
+                for (int side = 0; side < 4; side++) walls[side][Index(x, y)] = cell->walls[side];
+            }
+        }
+        return true;
+    }
+
+    bool IsWall(int x, int y, int side) const { return walls[side][Index(x, y)]; }
+
+    // Same test as MazeGenerator::CheckWallCollision
+    bool CheckWallCollision(Vector3 newPos) const {
+        int cellX = (int)((newPos.x + CELL_SIZE / 2) / CELL_SIZE);
+        int cellY = (int)((newPos.z + CELL_SIZE / 2) / CELL_SIZE);
+        if (cellX < 0 || cellX >= W || cellY < 0 || cellY >= H) return true;
+
+        float localX = newPos.x - (cellX * CELL_SIZE - CELL_SIZE / 2);
+        float localY = newPos.z - (cellY * CELL_SIZE - CELL_SIZE / 2);
+        int cell = Index(cellX, cellY);
+        if (walls[0][cell] && localY > CELL_SIZE - PLAYER_RADIUS) return true;
+        if (walls[1][cell] && localX > CELL_SIZE - PLAYER_RADIUS) return true;
+        if (walls[2][cell] && localY < PLAYER_RADIUS) return true;
+        if (walls[3][cell] && localX < PLAYER_RADIUS) return true;
+        return false;
+    }
+
+    // First cell on a shortest path from `from` to `to` (both Index values),
+    // `from` if already there, or -1 when unreachable
+    int NextStep(int from, int to) const {
+        if (from == to) return from;
+        std::array<int16_t, CELLS> parent;
+        std::array<int16_t, CELLS> queue;
+        std::bitset<CELLS> seen;
+        int head = 0;
+        int tail = 0;
+        queue[tail++] = (int16_t)from;
+        seen.set(from);
+        while (head < tail) {
+            int current = queue[head++];
+            for (int side = 0; side < 4; side++) {
+                if (walls[side][current]) continue;
+                int next = current + STEP[side];
+                if (seen[next]) continue;
+                seen.set(next);
+                parent[next] = (int16_t)current;
+                if (next == to) {
+                    while (parent[next] != from) next = parent[next];
+                    return next;
+                }
+                queue[tail++] = (int16_t)next;
+            }
+        }
+        return -1;
+    }
+};
+
 // NPC method implementations
 void NPC::Think(MazeGenerator& maze, Vector3 playerPos, float deltaTime) {
     thinkTimer += deltaTime;
@@ -258,19 +1099,19 @@ void NPC::Think(MazeGenerator& maze, Vector3 playerPos, float deltaTime) {
         
         float distToPlayer = Vector3Distance(position, playerPos);
         
-        if (distToPlayer < 3.0f) {
+        if (distToPlayer < fleeDistance) {
             state = FLEEING;
             Vector3 awayDir = Vector3Subtract(position, playerPos);
             awayDir = Vector3Normalize(awayDir);
             target = Vector3Add(position, Vector3Scale(awayDir, 2.0f));
         }
-        else if (distToPlayer < 5.0f) {
+        else if (distToPlayer < chaseDistance) {
             state = CHASING;
             target = playerPos;
         }
         else {
             state = WANDERING;
-            if (rand() % 10 < 3) {
+            if (maze.Random(10) < 3) {
                 target = maze.GetRandomSpawnPosition();
             }
         }
@@ -295,87 +1136,6325 @@ void NPC::Update(MazeGenerator& maze, float deltaTime) {
     }
 }
 
-void NPC::Draw() {
-    DrawSphere(position, PLAYER_RADIUS * 1.5f, color);
+void NPC::Draw(const MaterialAtlas& atlas) {
+    DrawAtlasSphere(position, PLAYER_RADIUS * 1.5f, 16, 16, atlas, ATLAS_NPC, color);
     DrawSphereWires(position, PLAYER_RADIUS * 1.5f, 8, 8, BLACK);
     
-    // Draw state indicator above NPC using billboard effect
-    const char* stateText = "";
-    Color stateColor = WHITE;
-    switch(state) {
-        case WANDERING: stateText = "?"; stateColor = GRAY; break;
-        case CHASING: stateText = "!"; stateColor = YELLOW; break;
-        case FLEEING: stateText = "!"; stateColor = RED; break;
-        case PATROLLING: stateText = "-"; stateColor = BLUE; break;
-    }
-    
     // Draw a small sphere above NPC as state indicator instead of text
     Vector3 indicatorPos = Vector3Add(position, (Vector3){0, 0.5f, 0});
-    DrawSphere(indicatorPos, 0.1f, stateColor);
+    DrawAtlasSphere(indicatorPos, 0.1f, 16, 16, atlas, ATLAS_WHITE, GetStateColor());
+    renderStats.drawCalls += 3;
 }
 
-struct Player {
-    Vector3 position;
-    float yaw = 0.0f;
-    float pitch = 0.0f;
+Color NPC::GetStateColor() const {
+    switch(state) {
+        case WANDERING: return GRAY;
+        case CHASING: return YELLOW;
+        case FLEEING: return RED;
+        case PATROLLING: return BLUE;
+    }
+    return WHITE;
+}
 
-    Vector3 GetForward() {
-        return {
-            cosf(pitch) * sinf(yaw),
-            sinf(pitch),
-            cosf(pitch) * cosf(yaw)
-        };
+// Crowd Settings
+const float NPC_RADIUS = PLAYER_RADIUS * 1.5f;      // as drawn
+const float CROWD_MAX_PUSH = NPC_RADIUS * 0.5f;     // per tick, so dense crowds ease apart without jitter
+
+// Local avoidance between NPCs: after they move, overlapping pairs are
+// pushed apart, half each, and the push slides along maze walls the way
+// player movement does. Agents are counting-sorted by cell every tick and
+// their positions copied into flat arrays in cell order. Cells are stored
+// column-major, so an agent's 3x3 neighbourhood is three contiguous runs,
+// and those runs are scanned four agents at a time where SSE2 is available.
+// Each tick is O(agents + cells).
+class CrowdSeparation {
+private:
+    std::vector<uint32_t> cellStart;    // per cell + 1: first slot in cell order
+    std::vector<uint32_t> order;        // per slot: NPC index
+    std::vector<uint32_t> npcCell;      // per NPC
+    std::vector<float> xs;              // per slot
+    std::vector<float> zs;
+    float minDistance = 2.0f * NPC_RADIUS;
+
+    static int CellCoord(float position, int size) {
+        return std::max(0, std::min(size - 1, (int)((position + CELL_SIZE / 2) / CELL_SIZE)));
     }
 
-    Vector3 GetRight() {
-        return {
-            cosf(yaw),
-            0.0f,
+    // Sum over slots [begin, end) of the overlap with (x, z), each along the
+    // unit vector away from the other agent. Agents exactly at (x, z),
+    // itself included, have no such vector and are counted in `duplicates`.
+    void AccumulatePush(float x, float z, uint32_t begin, uint32_t end, float& pushX, float& pushZ,
+                        int& duplicates) const {
+        const float minSqr = minDistance * minDistance;
+        uint32_t j = begin;
+#ifdef MAZE_USE_SSE2
+        __m128 px = _mm_set1_ps(x);
+        __m128 pz = _mm_set1_ps(z);
+        __m128 limit = _mm_set1_ps(minSqr);
+        __m128 distanceMin = _mm_set1_ps(minDistance);
+        __m128 zero = _mm_setzero_ps();
+        __m128 sumX = zero;
+        __m128 sumZ = zero;
+        for (; j + 4 <= end; j += 4) {
+            __m128 dx = _mm_sub_ps(px, _mm_loadu_ps(&xs[j]));
+            __m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(&zs[j]));
+            __m128 sqr = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dz, dz));
+            __m128 mask = _mm_and_ps(_mm_cmplt_ps(sqr, limit), _mm_cmpgt_ps(sqr, zero));
+            int same = _mm_movemask_ps(_mm_cmpeq_ps(sqr, zero));
+            duplicates += (same & 1) + (same >> 1 & 1) + (same >> 2 & 1) + (same >> 3 & 1);
+            __m128 distance = _mm_sqrt_ps(_mm_max_ps(sqr, _mm_set1_ps(1e-12f)));
+            __m128 scale = _mm_and_ps(mask, _mm_div_ps(_mm_sub_ps(distanceMin, distance), distance));
+            sumX = _mm_add_ps(sumX, _mm_mul_ps(dx, scale));
+            sumZ = _mm_add_ps(sumZ, _mm_mul_ps(dz, scale));
+        }
+        float lanesX[4], lanesZ[4];
+        _mm_storeu_ps(lanesX, sumX);
+        _mm_storeu_ps(lanesZ, sumZ);
+        pushX += lanesX[0] + lanesX[1] + lanesX[2] + lanesX[3];
+        pushZ += lanesZ[0] + lanesZ[1] + lanesZ[2] + lanesZ[3];
+#endif
+        for (; j < end; j++) {
+            float dx = x - xs[j];
+            float dz = z - zs[j];
+            float sqr = dx * dx + dz * dz;
+            if (sqr <= 0.0f) duplicates++;
+            if (sqr >= minSqr || sqr <= 0.0f) continue;
+            float distance = sqrtf(sqr);
+            float scale = (minDistance - distance) / distance;
+            pushX += dx * scale;
+            pushZ += dz * scale;
+        }
+    }
+
+    // Sorts agents by cell and copies their positions into cell order
+    void Index(const MazeGenerator& maze, NpcList npcs) {
+        const int width = maze.GetWidth();
+        const int height = maze.GetHeight();
+        const size_t count = npcs.size();
+        cellStart.assign((size_t)width * height + 1, 0);
+        npcCell.resize(count);
+        order.resize(count);
+        xs.resize(count);
+        zs.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t cell = (uint32_t)(CellCoord(npcs[i].position.x, width) * height +
+                                       CellCoord(npcs[i].position.z, height));
+            npcCell[i] = cell;
+            cellStart[cell + 1]++;
+        }
+        for (size_t cell = 1; cell < cellStart.size(); cell++) cellStart[cell] += cellStart[cell - 1];
+        for (size_t i = 0; i < count; i++) {
+            uint32_t slot = cellStart[npcCell[i]]++;
+            order[slot] = (uint32_t)i;
+            xs[slot] = npcs[i].position.x;
+            zs[slot] = npcs[i].position.z;
+        }
+        // The scatter advanced every start to the next cell's; shift back
+        for (size_t cell = cellStart.size() - 1; cell > 0; cell--) cellStart[cell] = cellStart[cell - 1];
+        cellStart[0] = 0;
+    }
+
+public:
+    void Apply(MazeGenerator& maze, NpcList npcs) {
+        MemoryScope scope(MemoryTag::NPCS);
+        if (npcs.size() < 2) return;
+        Index(maze, npcs);
+        const int width = maze.GetWidth();
+        const int height = maze.GetHeight();
+        for (uint32_t slot = 0; slot < (uint32_t)npcs.size(); slot++) {
+            NPC& npc = npcs[order[slot]];
+            int cellX = CellCoord(xs[slot], width);
+            int cellY = CellCoord(zs[slot], height);
+            int low = std::max(0, cellY - 1);
+            int high = std::min(height - 1, cellY + 1);
+            float pushX = 0.0f;
+            float pushZ = 0.0f;
+            int duplicates = -1;    // itself
+            for (int x = std::max(0, cellX - 1); x <= std::min(width - 1, cellX + 1); x++) {
+                AccumulatePush(xs[slot], zs[slot], cellStart[x * height + low], cellStart[x * height + high + 1],
+                               pushX, pushZ, duplicates);
+            }
+            // Agents stacked on one spot (spawns are cell centres) fan out,
+            // each in its own golden-angle direction
+            if (duplicates > 0) {
+                float angle = order[slot] * 2.39996f;
+                pushX += cosf(angle) * minDistance * duplicates;
+                pushZ += sinf(angle) * minDistance * duplicates;
+            }
+            if (pushX == 0.0f && pushZ == 0.0f) continue;
+
+            // Half the overlap each, capped; walls stop each axis separately
+            pushX *= 0.5f;
+            pushZ *= 0.5f;
+            float length = sqrtf(pushX * pushX + pushZ * pushZ);
+            if (length > CROWD_MAX_PUSH) {
+                pushX *= CROWD_MAX_PUSH / length;
+                pushZ *= CROWD_MAX_PUSH / length;
+            }
+            Vector3 movedX = {npc.position.x + pushX, npc.position.y, npc.position.z};
+            if (!maze.CheckWallCollision(movedX)) npc.position.x = movedX.x;
+            Vector3 movedZ = {npc.position.x, npc.position.y, npc.position.z + pushZ};
+            if (!maze.CheckWallCollision(movedZ)) npc.position.z = movedZ.z;
+        }
+    }
+
+    // Pairs of agents closer than `distance` (for measurement)
+    uint64_t CountOverlaps(const MazeGenerator& maze, NpcList npcs, float distance) {
+        if (npcs.size() < 2) return 0;
+        Index(maze, npcs);
+        const int width = maze.GetWidth();
+        const int height = maze.GetHeight();
+        const float minSqr = distance * distance;
+        uint64_t overlaps = 0;
+        for (uint32_t slot = 0; slot < (uint32_t)npcs.size(); slot++) {
+            int cellX = CellCoord(xs[slot], width);
+            int cellY = CellCoord(zs[slot], height);
+            int low = std::max(0, cellY - 1);
+            int high = std::min(height - 1, cellY + 1);
+            for (int x = std::max(0, cellX - 1); x <= std::min(width - 1, cellX + 1); x++) {
+                for (uint32_t j = cellStart[x * height + low]; j < cellStart[x * height + high + 1]; j++) {
+                    float dx = xs[slot] - xs[j];
+                    float dz = zs[slot] - zs[j];
+                    if (j > slot && dx * dx + dz * dz < minSqr) overlaps++;
+                }
+            }
+        }
+        return overlaps;
+    }
+};
+
+// Mesh Settings
+const int MESH_CHUNK_CELLS = 16;    // keeps each chunk under the 16-bit index limit
+const float OUTLINE_WIDTH = 1.0f;   // in pixels
+
+// Wall shader: atlas texel times baked vertex colour, plus a black outline. texcoord2 holds the
+// position within each face in [0, 1]; dividing the distance to the nearest
+// face edge by its screen-space derivative gives the distance in pixels, so
+// outlines keep a constant width at any range. Floor quads use a constant
+// texcoord2 and never get an outline.
+const char* WALL_VERTEX_SHADER = R"(
+#version 330
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec2 vertexTexCoord2;
+in vec4 vertexColor;
+uniform mat4 mvp;
+out vec2 fragTexCoord;
+out vec2 fragEdge;
+out vec4 fragColor;
+void main() {
+    fragTexCoord = vertexTexCoord;
+    fragEdge = vertexTexCoord2;
+    fragColor = vertexColor;
+    gl_Position = mvp * vec4(vertexPosition, 1.0);
+}
+)";
+
+const char* WALL_FRAGMENT_SHADER = R"(
+#version 330
+in vec2 fragTexCoord;
+in vec2 fragEdge;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+uniform vec4 outlineColor;
+uniform float outlineWidth;
+out vec4 finalColor;
+void main() {
+    vec2 pixels = min(fragEdge, 1.0 - fragEdge) / max(fwidth(fragEdge), vec2(1e-5));
+    float edge = 1.0 - smoothstep(outlineWidth - 0.5, outlineWidth + 0.5, min(pixels.x, pixels.y));
+    vec4 albedo = texture(texture0, fragTexCoord) * fragColor * colDiffuse;
+    finalColor = mix(albedo, outlineColor, edge);
+}
+)";
+
+// Static maze geometry (walls and floor) with lighting baked into vertex
+// colours: per-vertex ambient occlusion from the Cell wall layout plus a
+// corridor light level per cell. One draw call per chunk, nothing per frame.
+// Rebuild after every Generate().
+class MazeMesh {
+private:
+    struct ChunkBuilder {
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<float> edges;
+        std::vector<unsigned char> colors;
+        std::vector<unsigned short> indices;
+
+        void AddVertex(Vector3 position, Vector3 normal, Vector2 texcoord, Vector2 edge, Color color) {
+            vertices.insert(vertices.end(), {position.x, position.y, position.z});
+            normals.insert(normals.end(), {normal.x, normal.y, normal.z});
+            texcoords.insert(texcoords.end(), {texcoord.x, texcoord.y});
+            edges.insert(edges.end(), {edge.x, edge.y});
+            colors.insert(colors.end(), {color.r, color.g, color.b, color.a});
+        }
+
+        // Corners in order around the quad; winding is fixed up to face `normal`.
+        // The atlas region is stretched over the quad; outlined quads also get
+        // face coordinates for the edge shader.
+        void AddQuad(const Vector3 corners[4], const Color shades[4], Vector3 normal, AtlasRegion region,
+                     bool outlined = true) {
+            Rectangle uv = MaterialAtlas::GetRegion(region);
+            const Vector2 faceCoords[4] = {{0, 0}, {0, 1}, {1, 1}, {1, 0}};
+            int order[4] = {0, 1, 2, 3};
+            Vector3 cross = Vector3CrossProduct(Vector3Subtract(corners[1], corners[0]),
+                                                Vector3Subtract(corners[2], corners[0]));
+            if (Vector3DotProduct(cross, normal) < 0) std::swap(order[1], order[3]);
+
+            unsigned short base = (unsigned short)(vertices.size() / 3);
+            for (int i = 0; i < 4; i++) {
+                Vector2 face = faceCoords[order[i]];
+                Vector2 texcoord = {uv.x + face.x * uv.width, uv.y + (1.0f - face.y) * uv.height};
+                Vector2 edge = outlined ? face : (Vector2){0.5f, 0.5f};
+                AddVertex(corners[order[i]], normal, texcoord, edge, shades[order[i]]);
+            }
+            indices.insert(indices.end(), {base, (unsigned short)(base + 1), (unsigned short)(base + 2),
+                                           base, (unsigned short)(base + 2), (unsigned short)(base + 3)});
+        }
+
+        Mesh ToMesh() const {
+            Mesh mesh = {};
+            mesh.vertexCount = (int)(vertices.size() / 3);
+            mesh.triangleCount = (int)(indices.size() / 3);
+            mesh.vertices = (float*)MemAlloc((unsigned)(vertices.size() * sizeof(float)));
+            mesh.normals = (float*)MemAlloc((unsigned)(normals.size() * sizeof(float)));
+            mesh.texcoords = (float*)MemAlloc((unsigned)(texcoords.size() * sizeof(float)));
+            mesh.texcoords2 = (float*)MemAlloc((unsigned)(edges.size() * sizeof(float)));
+            mesh.colors = (unsigned char*)MemAlloc((unsigned)colors.size());
+            mesh.indices = (unsigned short*)MemAlloc((unsigned)(indices.size() * sizeof(unsigned short)));
+            memcpy(mesh.vertices, vertices.data(), vertices.size() * sizeof(float));
+            memcpy(mesh.normals, normals.data(), normals.size() * sizeof(float));
+            memcpy(mesh.texcoords, texcoords.data(), texcoords.size() * sizeof(float));
+            memcpy(mesh.texcoords2, edges.data(), edges.size() * sizeof(float));
+            memcpy(mesh.colors, colors.data(), colors.size());
+            memcpy(mesh.indices, indices.data(), indices.size() * sizeof(unsigned short));
+            return mesh;
+        }
+
+        size_t Bytes() const {
+            return (vertices.size() + normals.size() + texcoords.size() + edges.size()) * sizeof(float) +
+                   colors.size() + indices.size() * sizeof(unsigned short);
+        }
+    };
+
+    std::vector<Model> chunks;
+    std::vector<float> cellLight;
+    int width = 0;
+    int height = 0;
+    Shader shader = {};
+    bool shaderLoaded = false;
+    int64_t trackedBytes = 0;
+
+    static Vector3 SideDir(int side) { return {(float)SIDE_DX[side], 0.0f, (float)SIDE_DY[side]}; }
+
+    static Color Shade(Color base, float factor) {
+        auto channel = [&](unsigned char c) { return (unsigned char)std::min(255.0f, c * factor); };
+        return {channel(base.r), channel(base.g), channel(base.b), 255};
+    }
+
+    float LightAt(int x, int y) const {
+        if (x < 0 || x >= width || y < 0 || y >= height) return 0.7f;
+        return cellLight[(size_t)x * height + y];
+    }
+
+    // Light level per cell: open junctions are brighter than dead ends, then
+    // spread along open walls so corridors fade smoothly
+    void BakeCellLight(MazeGenerator& maze) {
+        cellLight.assign((size_t)width * height, 0.0f);
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < height; y++) {
+                Cell* cell = maze.GetCell(x, y);
+                int open = 0;
+                for (int side = 0; side < 4; side++) open += cell->walls[side] ? 0 : 1;
+                cellLight[(size_t)x * height + y] = 0.7f + 0.1f * open;
+            }
+        }
+
+        std::vector<float> blurred(cellLight.size());
+        for (int pass = 0; pass < 2; pass++) {
+            for (int x = 0; x < width; x++) {
+                for (int y = 0; y < height; y++) {
+                    Cell* cell = maze.GetCell(x, y);
+                    float sum = LightAt(x, y);
+                    int count = 1;
+                    for (int side = 0; side < 4; side++) {
+                        if (cell->walls[side]) continue;
+                        sum += LightAt(x + SIDE_DX[side], y + SIDE_DY[side]);
+                        count++;
+                    }
+                    blurred[(size_t)x * height + y] = sum / count;
+                }
+            }
+            cellLight.swap(blurred);
+        }
+    }
+
+    // Wall on `side` of cell (x, y) as a box without its (hidden) bottom face
+    void AddWall(ChunkBuilder& builder, MazeGenerator& maze, int x, int y, int side) {
+        const Color base = {110, 110, 110, 255};
+        const float halfThickness = WALL_THICKNESS / 2;
+        const float halfLength = (CELL_SIZE + WALL_THICKNESS) / 2;
+        const float bottomOcclusion = 0.65f;
+        const float cornerOcclusion = 0.7f;
+
+        Vector3 dir = SideDir(side);
+        Vector3 center = {x * CELL_SIZE + dir.x * CELL_SIZE / 2, 0.0f, y * CELL_SIZE + dir.z * CELL_SIZE / 2};
+        int ends[2] = {(side + 1) % 4, (side + 3) % 4};
+        int nx = x + SIDE_DX[side];
+        int ny = y + SIDE_DY[side];
+
+        // Long faces: one facing back into (x, y), one into the neighbour
+        for (int facing = 0; facing < 2; facing++) {
+            int qx = facing == 0 ? x : nx;
+            int qy = facing == 0 ? y : ny;
+            Vector3 normal = facing == 0 ? Vector3Scale(dir, -1.0f) : dir;
+            Cell* faced = maze.GetCell(qx, qy);
+            float light = LightAt(qx, qy) * (side % 2 == 0 ? 1.0f : 0.9f);
+
+            Vector3 corners[4];
+            Color shades[4];
+            for (int i = 0; i < 4; i++) {
+                int end = ends[i < 2 ? 0 : 1];
+                bool top = (i == 1 || i == 2);
+                Vector3 offset = Vector3Add(Vector3Scale(normal, halfThickness), Vector3Scale(SideDir(end), halfLength));
+                corners[i] = {center.x + offset.x, top ? WALL_HEIGHT : 0.0f, center.z + offset.z};
+
+                // Concave corner where a perpendicular wall meets this face
+                float occlusion = top ? 1.0f : bottomOcclusion;
+                if (faced && faced->walls[end]) occlusion *= cornerOcclusion;
+                shades[i] = Shade(base, light * occlusion);
+            }
+            builder.AddQuad(corners, shades, normal, ATLAS_WALL);
+        }
+
+        // End caps
+        for (int end : ends) {
+            Vector3 along = SideDir(end);
+            Vector3 corners[4];
+            Color shades[4];
+            for (int i = 0; i < 4; i++) {
+                float across = (i < 2) ? -halfThickness : halfThickness;
+                bool top = (i == 1 || i == 2);
+                Vector3 offset = Vector3Add(Vector3Scale(along, halfLength), Vector3Scale(dir, across));
+                corners[i] = {center.x + offset.x, top ? WALL_HEIGHT : 0.0f, center.z + offset.z};
+                shades[i] = Shade(base, 0.8f * (top ? 1.0f : bottomOcclusion));
+            }
+            builder.AddQuad(corners, shades, along, ATLAS_WALL);
+        }
+
+        // Top face sees the sky: lit from both sides of the wall
+        Color topShade = Shade(base, 1.1f * (LightAt(x, y) + LightAt(nx, ny)) / 2);
+        Vector3 corners[4];
+        Color shades[4] = {topShade, topShade, topShade, topShade};
+        for (int i = 0; i < 4; i++) {
+            float across = (i == 0 || i == 3) ? -halfThickness : halfThickness;
+            float lengthwise = (i < 2) ? -halfLength : halfLength;
+            Vector3 offset = Vector3Add(Vector3Scale(dir, across), Vector3Scale(SideDir(ends[0]), lengthwise));
+            corners[i] = {center.x + offset.x, WALL_HEIGHT, center.z + offset.z};
+        }
+        builder.AddQuad(corners, shades, {0.0f, 1.0f, 0.0f}, ATLAS_WALL);
+    }
+
+    // Floor quad for one cell, darkened in corners enclosed by walls
+    void AddFloor(ChunkBuilder& builder, MazeGenerator& maze, int x, int y) {
+        const int cornerSides[4][2] = {{3, 2}, {3, 0}, {1, 0}, {1, 2}};
+        Cell* cell = maze.GetCell(x, y);
+        float light = LightAt(x, y);
+
+        Vector3 corners[4];
+        Color shades[4];
+        for (int i = 0; i < 4; i++) {
+            int sideX = cornerSides[i][0];
+            int sideY = cornerSides[i][1];
+            corners[i] = {(x + SIDE_DX[sideX] * 0.5f) * CELL_SIZE, 0.0f, (y + SIDE_DY[sideY] * 0.5f) * CELL_SIZE};
+            int walls = (cell->walls[sideX] ? 1 : 0) + (cell->walls[sideY] ? 1 : 0);
+            shades[i] = Shade(DARKGREEN, light * (1.0f - 0.15f * walls));
+        }
+        builder.AddQuad(corners, shades, {0.0f, 1.0f, 0.0f}, ATLAS_FLOOR, false);
+    }
+
+    void LoadShader() {
+        shaderLoaded = true;
+        shader = LoadShaderFromMemory(WALL_VERTEX_SHADER, WALL_FRAGMENT_SHADER);
+        if (shader.id == rlGetShaderIdDefault()) {
+            // No GLSL 330: walls keep their baked shading without outlines
+            TraceLog(LOG_WARNING, "MAZE: Wall outline shader unavailable, drawing without outlines");
+            shader.id = 0;
+            return;
+        }
+        const float outlineColor[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+        SetShaderValue(shader, GetShaderLocation(shader, "outlineColor"), outlineColor, SHADER_UNIFORM_VEC4);
+        SetShaderValue(shader, GetShaderLocation(shader, "outlineWidth"), &OUTLINE_WIDTH, SHADER_UNIFORM_FLOAT);
+    }
+
+    void UnloadChunks() {
+        for (auto& chunk : chunks) UnloadModel(chunk);
+        chunks.clear();
+        TrackMemory(MemoryTag::MESHES, -trackedBytes);
+        trackedBytes = 0;
+    }
+
+public:
+    void Build(MazeGenerator& maze) {
+        MemoryScope scope(MemoryTag::MESHES);
+        UnloadChunks();
+        if (!shaderLoaded) LoadShader();
+        width = maze.GetWidth();
+        height = maze.GetHeight();
+        BakeCellLight(maze);
+
+        for (int chunkX = 0; chunkX < width; chunkX += MESH_CHUNK_CELLS) {
+            for (int chunkY = 0; chunkY < height; chunkY += MESH_CHUNK_CELLS) {
+                ChunkBuilder builder;
+                for (int x = chunkX; x < std::min(chunkX + MESH_CHUNK_CELLS, width); x++) {
+                    for (int y = chunkY; y < std::min(chunkY + MESH_CHUNK_CELLS, height); y++) {
+                        Cell* cell = maze.GetCell(x, y);
+                        // Same ownership rule as the minimap: each shared wall once
+                        if (cell->walls[0]) AddWall(builder, maze, x, y, 0);
+                        if (cell->walls[1]) AddWall(builder, maze, x, y, 1);
+                        if (y == 0 && cell->walls[2]) AddWall(builder, maze, x, y, 2);
+                        if (x == 0 && cell->walls[3]) AddWall(builder, maze, x, y, 3);
+                        AddFloor(builder, maze, x, y);
+                    }
+                }
+
+                Mesh mesh = builder.ToMesh();
+                UploadMesh(&mesh, false);
+                // raylib keeps the CPU arrays next to the GPU buffers
+                trackedBytes += 2 * (int64_t)builder.Bytes();
+                chunks.push_back(LoadModelFromMesh(mesh));
+                if (shader.id != 0) chunks.back().materials[0].shader = shader;
+            }
+        }
+        TrackMemory(MemoryTag::MESHES, trackedBytes);
+    }
+
+    void Unload() {
+        UnloadChunks();
+        if (shader.id != 0) UnloadShader(shader);
+        shader = {};
+        shaderLoaded = false;
+    }
+
+    int GetChunkCount() const { return (int)chunks.size(); }
+
+    void Draw(const MaterialAtlas& atlas) {
+        for (auto& chunk : chunks) {
+            chunk.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = atlas.GetTexture();
+            DrawModel(chunk, {0, 0, 0}, 1.0f, WHITE);
+        }
+        renderStats.drawCalls += (int)chunks.size();
+    }
+};
+
+struct Player {
+    Vector3 position;
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    float speed = PLAYER_SPEED;
+
+    Vector3 GetForward() {
+        return {
+            cosf(pitch) * sinf(yaw),
+            sinf(pitch),
+            cosf(pitch) * cosf(yaw)
+        };
+    }
+
+    Vector3 GetRight() {
+        return {
+            cosf(yaw),
+            0.0f,
             -sinf(yaw)
         };
     }
 };
 
-int main() {
+enum InputButton : uint8_t {
+    INPUT_FORWARD = 1 << 0,
+    INPUT_BACK = 1 << 1,
+    INPUT_RIGHT = 1 << 2,
+    INPUT_LEFT = 1 << 3,
+};
+
+// One tick of player control: absolute view angles plus held movement keys.
+// The same input gives the same result anywhere, so it can be sent to an
+// authoritative server and replayed.
+struct PlayerInput {
+    uint32_t sequence = 0;
+    float yaw = 0.0f;
+    float pitch = 0.0f;
+    uint8_t buttons = 0;
+};
+
+void ApplyPlayerInput(Player& player, MazeGenerator& maze, const PlayerInput& input, float deltaTime) {
+    player.yaw = input.yaw;
+    player.pitch = input.pitch;
+
+    Vector3 forward = player.GetForward();
+    Vector3 right = player.GetRight();
+
+    Vector3 moveForward = {forward.x, 0, forward.z};
+    moveForward = Vector3Normalize(moveForward);
+
+    Vector3 velocity = {0, 0, 0};
+
+    if (input.buttons & INPUT_FORWARD) {
+        velocity.x += moveForward.x * player.speed * deltaTime;
+        velocity.z += moveForward.z * player.speed * deltaTime;
+    }
+    if (input.buttons & INPUT_BACK) {
+        velocity.x -= moveForward.x * player.speed * deltaTime;
+        velocity.z -= moveForward.z * player.speed * deltaTime;
+    }
+    if (input.buttons & INPUT_RIGHT) {
+        velocity.x += right.x * player.speed * deltaTime;
+        velocity.z += right.z * player.speed * deltaTime;
+    }
+    if (input.buttons & INPUT_LEFT) {
+        velocity.x -= right.x * player.speed * deltaTime;
+        velocity.z -= right.z * player.speed * deltaTime;
+    }
+
+    // Apply movement with collision
+    Vector3 newPosX = {player.position.x + velocity.x, player.position.y, player.position.z};
+    Vector3 newPosZ = {player.position.x, player.position.y, player.position.z + velocity.z};
+
+    if (!maze.CheckWallCollision(newPosX)) {
+        player.position.x = newPosX.x;
+    }
+    if (!maze.CheckWallCollision(newPosZ)) {
+        player.position.z = newPosZ.z;
+    }
+}
+
+// Keyboard state as movement buttons
+uint8_t ReadMovementButtons() {
+    uint8_t buttons = 0;
+    if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) buttons |= INPUT_FORWARD;
+    if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) buttons |= INPUT_BACK;
+    if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) buttons |= INPUT_RIGHT;
+    if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) buttons |= INPUT_LEFT;
+    return buttons;
+}
+
+static_assert(std::is_trivially_copyable<Player>::value && std::is_trivially_copyable<NPC>::value &&
+              std::is_trivially_copyable<Cell>::value && std::is_trivially_copyable<Rng>::value,
+              "world state must be trivially copyable");
+
+// All mutable state of a local game in one flat block: a header (tick,
+// player, the maze RNG, counts) followed by the NPC array, the AI police
+// officers of a squad (none by default) and the maze cells. Nothing in it
+// points anywhere, so a snapshot is one memcpy of the block and restoring
+// one is another. A MazeGenerator bound to it keeps its cells and RNG here;
+// the NPC array is used through NpcList.
+class WorldState {
+public:
+    struct Header {
+        uint64_t tick;
+        uint32_t mazeRevision;      // unique per generated maze, from a counter outside the arena
+        uint32_t npcCount;
+        int32_t mazeWidth;
+        int32_t mazeHeight;
+        uint32_t captures;          // bandits arrested by the player (and squad)
+        uint32_t policeCount;       // AI officers besides the player
+        Rng rng;
+        Player player;
+    };
+
+private:
+    LargeVector<uint64_t, MemoryTag::NPCS> storage;  // 8-byte words keep every section aligned
+    size_t npcOffset = 0;
+    size_t policeOffset = 0;
+    size_t cellOffset = 0;
+    size_t size = 0;
+
+    static size_t AlignUp(size_t bytes) { return (bytes + 7) & ~(size_t)7; }
+
+    void Layout(uint32_t npcCount, uint32_t policeCount, int mazeWidth, int mazeHeight) {
+        npcOffset = AlignUp(sizeof(Header));
+        policeOffset = AlignUp(npcOffset + sizeof(NPC) * npcCount);
+        cellOffset = AlignUp(policeOffset + sizeof(Player) * policeCount);
+        size = AlignUp(cellOffset + sizeof(Cell) * (size_t)mazeWidth * mazeHeight);
+        storage.resize(size / 8);
+    }
+
+public:
+    // (Re)allocates for the given counts; the contents start zeroed
+    void Allocate(int npcCount, int mazeWidth, int mazeHeight, int policeCount = 0) {
+        MemoryScope scope(MemoryTag::NPCS);
+        storage.clear();
+        Layout((uint32_t)npcCount, (uint32_t)policeCount, mazeWidth, mazeHeight);
+        Header& header = GetHeader();
+        header = Header();
+        header.npcCount = (uint32_t)npcCount;
+        header.policeCount = (uint32_t)policeCount;
+        header.mazeWidth = mazeWidth;
+        header.mazeHeight = mazeHeight;
+        for (int i = 0; i < npcCount; i++) new (&GetNpcs()[i]) NPC();
+        for (int i = 0; i < policeCount; i++) new (&GetPolice()[i]) Player();
+        for (int i = 0; i < mazeWidth * mazeHeight; i++) new (&GetCells()[i]) Cell();
+    }
+
+    Header& GetHeader() { return *(Header*)storage.data(); }
+    const Header& GetHeader() const { return *(const Header*)storage.data(); }
+    NPC* GetNpcs() { return (NPC*)((unsigned char*)storage.data() + npcOffset); }
+    Player* GetPolice() { return (Player*)((unsigned char*)storage.data() + policeOffset); }
+    Cell* GetCells() { return (Cell*)((unsigned char*)storage.data() + cellOffset); }
+    NpcList GetNpcList() { return NpcList(GetNpcs(), GetHeader().npcCount); }
+    size_t GetCellCount() const { return (size_t)GetHeader().mazeWidth * GetHeader().mazeHeight; }
+    size_t GetSize() const { return size; }
+
+    void BindMaze(MazeGenerator& maze) { maze.Bind(GetCells(), GetCellCount(), &GetHeader().rng); }
+
+    void Save(std::vector<uint64_t>& snapshot) const {
+        MemoryScope scope(MemoryTag::NPCS);
+        snapshot.resize(storage.size());
+        memcpy(snapshot.data(), storage.data(), size);
+    }
+
+    // Returns false when the snapshot has other counts than the current
+    // layout (the caller then reallocates and rebinds)
+    bool Restore(const std::vector<uint64_t>& snapshot) {
+        if (snapshot.size() != storage.size()) return false;
+        const Header& saved = *(const Header*)snapshot.data();
+        const Header& current = GetHeader();
+        if (saved.npcCount != current.npcCount || saved.policeCount != current.policeCount ||
+            saved.mazeWidth != current.mazeWidth || saved.mazeHeight != current.mazeHeight) {
+            return false;
+        }
+        memcpy(storage.data(), snapshot.data(), size);
+        return true;
+    }
+};
+
+// Puts an arrested bandit back at a random spawn out of sight of `police`,
+// so the NPC count stays fixed
+void RespawnBandit(NPC& bandit, Vector3 police, MazeGenerator& maze) {
+    for (int attempt = 0; attempt < 8; attempt++) {
+        bandit.position = maze.GetRandomSpawnPosition();
+        if (Vector3Distance(bandit.position, police) > 5.0f) break;
+    }
+    bandit.target = maze.GetRandomSpawnPosition();
+    bandit.state = NPC::WANDERING;
+    bandit.thinkTimer = 0.0f;
+}
+
+// Arrests every bandit within CAPTURE_RADIUS of `police` and returns how
+// many were arrested
+int CaptureBandits(Vector3 police, NpcList bandits, MazeGenerator& maze) {
+    int captured = 0;
+    for (NPC& bandit : bandits) {
+        float dx = bandit.position.x - police.x;
+        float dz = bandit.position.z - police.z;
+        if (dx * dx + dz * dz > CAPTURE_RADIUS * CAPTURE_RADIUS) continue;
+        captured++;
+        RespawnBandit(bandit, police, maze);
+    }
+    return captured;
+}
+
+// One fixed step of a local game: the player's input, then every NPC
+// (kept apart by `crowd` when given), then arrests
+void StepWorld(WorldState& world, MazeGenerator& maze, const PlayerInput& input, float dt,
+               CrowdSeparation* crowd = nullptr) {
+    WorldState::Header& header = world.GetHeader();
+    ApplyPlayerInput(header.player, maze, input, dt);
+    for (NPC& npc : world.GetNpcList()) {
+        npc.Think(maze, header.player.position, dt);
+        npc.Update(maze, dt);
+    }
+    if (crowd) crowd->Apply(maze, world.GetNpcList());
+    header.captures += CaptureBandits(header.player.position, world.GetNpcList(), maze);
+    header.tick++;
+}
+
+// Network Settings
+const int SERVER_PORT = 27960;
+const int SERVER_TICK_RATE = 60;
+const uint8_t NET_PROTOCOL_VERSION = 3;
+const int NET_MAX_PACKET = 1200;            // stays under common path MTUs
+const int NET_MAX_CLIENTS = 4096;
+const double NET_CLIENT_TIMEOUT = 5.0;
+const double NET_CONNECT_RETRY = 0.5;
+const int NET_SNAPSHOT_PLAYERS = 32;        // nearest police sent to each client
+const int NET_SNAPSHOT_HISTORY = 32;        // ticks of world state kept as delta baselines
+const int NET_OFFSET_BITS = 8;              // fixed-point position within a cell (1/256 cell)
+const int NET_NAIVE_NPC_BYTES = 29;         // float position and target, colour, state
+const int NET_INTEREST_DEPTH = 6;           // corridor distance (cells) of NPCs sent to a client
+const int NET_INTEREST_SIGHT = 24;          // cells seen down straight corridors
+const size_t NET_MAX_PENDING_INPUTS = 8;    // queued inputs per client; older ones are dropped
+const int NET_MAX_NPCS = 65535;             // snapshot entry counts and offsets are 16 bits
+
+enum PacketType : uint8_t {
+    PACKET_CONNECT = 1,     // client -> server: protocol version
+    PACKET_WELCOME,         // server -> client: id, maze seed and size, tick rate
+    PACKET_INPUT,           // client -> server: snapshot ack, latest inputs newest first
+    PACKET_SNAPSHOT,        // server -> client: world state delta (may span several packets)
+    PACKET_DISCONNECT,
+};
+
+// Little-endian packet serialisation. Writes past the end set `overflow`,
+// reads past the end set `error` and return zeros.
+class PacketWriter {
+private:
+    uint8_t data[NET_MAX_PACKET];
+    size_t size = 0;
+
+public:
+    bool overflow = false;
+
+    void U8(uint8_t v) {
+        if (size + 1 > sizeof(data)) { overflow = true; return; }
+        data[size++] = v;
+    }
+    void U16(uint16_t v) { U8((uint8_t)v); U8((uint8_t)(v >> 8)); }
+    void U32(uint32_t v) { U16((uint16_t)v); U16((uint16_t)(v >> 16)); }
+    void F32(float v) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        U32(bits);
+    }
+
+    void Bytes(const uint8_t* bytes, size_t count) {
+        if (size + count > sizeof(data)) { overflow = true; return; }
+        memcpy(data + size, bytes, count);
+        size += count;
+    }
+
+    size_t Remaining() const { return sizeof(data) - size; }
+    size_t GetSize() const { return size; }
+    const uint8_t* GetData() const { return data; }
+};
+
+class PacketReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+
+public:
+    bool error = false;
+
+    PacketReader(const uint8_t* packet, size_t length) : data(packet), size(length) {}
+
+    uint8_t U8() {
+        if (offset + 1 > size) { error = true; return 0; }
+        return data[offset++];
+    }
+    uint16_t U16() { uint16_t lo = U8(); return (uint16_t)(lo | (U8() << 8)); }
+    uint32_t U32() { uint32_t lo = U16(); return lo | ((uint32_t)U16() << 16); }
+    float F32() {
+        uint32_t bits = U32();
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    // Returns `count` bytes in place, or nullptr past the end
+    const uint8_t* Bytes(size_t count) {
+        if (offset + count > size) { error = true; return nullptr; }
+        offset += count;
+        return data + offset - count;
+    }
+
+    size_t Remaining() const { return size - offset; }
+};
+
+// Bit packing, least significant bit first, into at most one packet's worth
+// of bytes. Writes past `capacityBits` set `overflow`; Rewind undoes them.
+class BitWriter {
+private:
+    uint8_t data[NET_MAX_PACKET];
+    size_t bitCount = 0;
+    size_t capacityBits;
+
+public:
+    bool overflow = false;
+
+    explicit BitWriter(size_t capacityBytes = NET_MAX_PACKET)
+        : capacityBits(std::min(capacityBytes, (size_t)NET_MAX_PACKET) * 8) {}
+
+    void Write(uint32_t value, int count) {
+        if (bitCount + count > capacityBits) { overflow = true; return; }
+        for (int done = 0; done < count;) {
+            int shift = (int)(bitCount & 7);
+            int take = std::min(8 - shift, count - done);
+            if (shift == 0) data[bitCount >> 3] = 0;
+            data[bitCount >> 3] |= (uint8_t)(((value >> done) & ((1u << take) - 1)) << shift);
+            done += take;
+            bitCount += take;
+        }
+    }
+
+    void Rewind(size_t mark) {
+        bitCount = mark;
+        overflow = false;
+        if (bitCount & 7) data[bitCount >> 3] &= (uint8_t)((1u << (bitCount & 7)) - 1);
+    }
+
+    size_t GetBitCount() const { return bitCount; }
+    size_t GetSize() const { return (bitCount + 7) / 8; }
+    const uint8_t* GetData() const { return data; }
+};
+
+class BitReader {
+private:
+    const uint8_t* data;
+    size_t sizeBits;
+    size_t bitCount = 0;
+
+public:
+    bool error = false;
+
+    BitReader(const uint8_t* bytes, size_t size) : data(bytes), sizeBits(size * 8) {}
+
+    uint32_t Read(int count) {
+        if (bitCount + count > sizeBits) { error = true; return 0; }
+        uint32_t value = 0;
+        for (int done = 0; done < count;) {
+            int shift = (int)(bitCount & 7);
+            int take = std::min(8 - shift, count - done);
+            value |= (uint32_t)((data[bitCount >> 3] >> shift) & ((1u << take) - 1)) << done;
+            done += take;
+            bitCount += take;
+        }
+        return value;
+    }
+};
+
+struct NetAddress {
+    uint32_t ip = 0;        // host byte order
+    uint16_t port = 0;
+
+    bool operator==(const NetAddress& other) const { return ip == other.ip && port == other.port; }
+};
+
+// Parse "host[:port]" for IPv4 dotted quads and "localhost"
+static bool ParseAddress(const char* text, NetAddress& address) {
+    std::string host = text;
+    address.port = SERVER_PORT;
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        address.port = (uint16_t)atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+    if (host.empty() || host == "localhost") host = "127.0.0.1";
+    unsigned a, b, c, d;
+    if (sscanf(host.c_str(), "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+    address.ip = (a << 24) | (b << 16) | (c << 8) | d;
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAZE_HAS_NETWORK 1
+
+// Non-blocking IPv4 UDP socket
+class UdpSocket {
+private:
+    int fd = -1;
+
+public:
+    UdpSocket() = default;
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+    ~UdpSocket() { Close(); }
+
+    // Port 0 binds an ephemeral port; `loopbackOnly` binds 127.0.0.1
+    bool Open(uint16_t port, bool loopbackOnly = false) {
+        Close();
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) return false;
+
+        sockaddr_in local = {};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+        int buffer = 4 << 20;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+        if (bind(fd, (sockaddr*)&local, sizeof(local)) != 0 || fcntl(fd, F_SETFL, O_NONBLOCK) != 0) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+
+    bool IsOpen() const { return fd >= 0; }
+    int GetHandle() const { return fd; }
+
+    uint16_t GetPort() const {
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        if (getsockname(fd, (sockaddr*)&local, &length) != 0) return 0;
+        return ntohs(local.sin_port);
+    }
+
+    bool Send(const NetAddress& to, const void* data, size_t size) {
+        sockaddr_in remote = {};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(to.port);
+        remote.sin_addr.s_addr = htonl(to.ip);
+        return sendto(fd, data, size, 0, (sockaddr*)&remote, sizeof(remote)) == (ssize_t)size;
+    }
+
+    // Returns the datagram size, or -1 when nothing is pending
+    int Receive(NetAddress& from, void* data, size_t capacity) {
+        sockaddr_in remote = {};
+        socklen_t length = sizeof(remote);
+        ssize_t received = recvfrom(fd, data, capacity, 0, (sockaddr*)&remote, &length);
+        if (received < 0) return -1;
+        from.ip = ntohl(remote.sin_addr.s_addr);
+        from.port = ntohs(remote.sin_port);
+        return (int)received;
+    }
+};
+#endif
+
+// Simulated network conditions, applied by a client to both directions
+struct LinkConditions {
+    float latencyMs = 0.0f;     // round trip, split evenly between directions
+    float jitterMs = 0.0f;      // uniform +/- per packet and direction
+    float lossPercent = 0.0f;   // per packet and direction
+
+    bool IsActive() const { return latencyMs > 0.0f || jitterMs > 0.0f || lossPercent > 0.0f; }
+};
+
+// Holds packets back until their simulated delivery time or drops them.
+// Packets due at the same time leave in the order they came, so only
+// jitter reorders them, as on a real link.
+class LinkSimulator {
+private:
+    struct Delayed {
+        double due;
+        uint64_t order;             // push count, breaks ties on `due`
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<Delayed> queue;     // min-heap on (`due`, `order`)
+    uint64_t pushed = 0;
+    LinkConditions conditions;
+    Rng rng;
+
+    float Uniform() { return rng.Next() / 4294967296.0f; }
+
+    static bool Later(const Delayed& a, const Delayed& b) {
+        return a.due != b.due ? a.due > b.due : a.order > b.order;
+    }
+
+public:
+    void Configure(const LinkConditions& link, uint64_t seed) {
+        conditions = link;
+        rng.Seed(seed);
+    }
+
+    bool IsActive() const { return conditions.IsActive(); }
+
+    void Push(double now, const uint8_t* data, size_t size) {
+        if (Uniform() * 100.0f < conditions.lossPercent) return;
+        float delayMs = conditions.latencyMs / 2 + (Uniform() * 2.0f - 1.0f) * conditions.jitterMs;
+        queue.push_back({now + std::max(0.0f, delayMs) / 1000.0, pushed++, std::vector<uint8_t>(data, data + size)});
+        std::push_heap(queue.begin(), queue.end(), Later);
+    }
+
+    // Calls deliver(data, size) for every packet due by `now`, earliest first
+    template <typename Callback>
+    void Deliver(double now, Callback deliver) {
+        while (!queue.empty() && queue.front().due <= now) {
+            std::pop_heap(queue.begin(), queue.end(), Later);
+            Delayed packet = std::move(queue.back());
+            queue.pop_back();
+            deliver(packet.data.data(), packet.data.size());
+        }
+    }
+};
+
+// Replicated state of one police player
+struct NetPlayer {
+    uint16_t id;
+    Vector3 position;
+    float yaw;
+};
+
+// Quantized NPC as replicated. Positions are cell index and fixed-point
+// offset packed into one integer per axis: (pos / CELL_SIZE + 0.5) * 256,
+// so cell (x, y) spans [x * 256, x * 256 + 255]. The y axis is implied.
+struct NetEntity {
+    uint32_t x, z;
+    uint32_t targetX, targetZ;
+    uint8_t state;
+    uint8_t r, g, b;
+};
+
+// Snapshot entity encoding. Against a baseline (the client's last acked
+// snapshot) an unchanged NPC costs one bit and a walking one about two
+// bytes: small position deltas in 4/8/12 bits, target and state only when
+// they change. Without a baseline every field is sent in full.
+class SnapshotCodec {
+private:
+    int coordBits = NET_OFFSET_BITS + 1;
+    uint32_t coordMax = (1u << (NET_OFFSET_BITS + 1)) - 1;
+
+    uint32_t QuantizeCoord(float v) const {
+        long q = lroundf((v / CELL_SIZE + 0.5f) * (1 << NET_OFFSET_BITS));
+        return (uint32_t)std::max(0L, std::min((long)coordMax, q));
+    }
+
+    float DequantizeCoord(uint32_t q) const {
+        return ((float)q / (1 << NET_OFFSET_BITS) - 0.5f) * CELL_SIZE;
+    }
+
+    // 2-bit size class, then a signed 4/8/12-bit delta or the raw value
+    void WriteDelta(BitWriter& writer, uint32_t value, uint32_t base) const {
+        static const int widths[3] = {4, 8, 12};
+        int32_t delta = (int32_t)value - (int32_t)base;
+        for (int size = 0; size < 3; size++) {
+            int32_t limit = 1 << (widths[size] - 1);
+            if (delta >= -limit && delta < limit) {
+                writer.Write(size, 2);
+                writer.Write((uint32_t)delta, widths[size]);
+                return;
+            }
+        }
+        writer.Write(3, 2);
+        writer.Write(value, coordBits);
+    }
+
+    uint32_t ReadDelta(BitReader& reader, uint32_t base) const {
+        static const int widths[3] = {4, 8, 12};
+        uint32_t size = reader.Read(2);
+        if (size == 3) return reader.Read(coordBits);
+        int width = widths[size];
+        int32_t delta = (int32_t)reader.Read(width);
+        if (delta & (1 << (width - 1))) delta -= 1 << width;
+        return (uint32_t)((int32_t)base + delta);
+    }
+
+public:
+    // Coordinates need enough bits for one cell past the far edge
+    void Configure(int mazeWidth, int mazeHeight) {
+        int cellBits = 1;
+        while ((1 << cellBits) <= std::max(mazeWidth, mazeHeight)) cellBits++;
+        coordBits = cellBits + NET_OFFSET_BITS;
+        coordMax = (1u << coordBits) - 1;
+    }
+
+    NetEntity Quantize(const NPC& npc) const {
+        NetEntity entity;
+        entity.x = QuantizeCoord(npc.position.x);
+        entity.z = QuantizeCoord(npc.position.z);
+        entity.targetX = QuantizeCoord(npc.target.x);
+        entity.targetZ = QuantizeCoord(npc.target.z);
+        entity.state = (uint8_t)npc.state;
+        entity.r = npc.color.r;
+        entity.g = npc.color.g;
+        entity.b = npc.color.b;
+        return entity;
+    }
+
+    void Dequantize(const NetEntity& entity, NPC& npc) const {
+        npc.position = {DequantizeCoord(entity.x), PLAYER_HEIGHT / 2, DequantizeCoord(entity.z)};
+        npc.target = {DequantizeCoord(entity.targetX), PLAYER_HEIGHT / 2, DequantizeCoord(entity.targetZ)};
+        npc.state = (NPC::State)entity.state;
+        npc.color = {entity.r, entity.g, entity.b, 255};
+    }
+
+    void Write(BitWriter& writer, const NetEntity& entity, const NetEntity* base) const {
+        if (!base) {
+            writer.Write(entity.x, coordBits);
+            writer.Write(entity.z, coordBits);
+            writer.Write(entity.targetX, coordBits);
+            writer.Write(entity.targetZ, coordBits);
+            writer.Write(entity.state, 2);
+            writer.Write(entity.r | (entity.g << 8) | (entity.b << 16), 24);
+            return;
+        }
+
+        bool moved = entity.x != base->x || entity.z != base->z;
+        bool retargeted = entity.targetX != base->targetX || entity.targetZ != base->targetZ;
+        bool stateChanged = entity.state != base->state;
+        writer.Write(moved || retargeted || stateChanged, 1);
+        if (!(moved || retargeted || stateChanged)) return;
+
+        writer.Write(moved, 1);
+        if (moved) {
+            WriteDelta(writer, entity.x, base->x);
+            WriteDelta(writer, entity.z, base->z);
+        }
+        writer.Write(retargeted, 1);
+        if (retargeted) {
+            writer.Write(entity.targetX, coordBits);
+            writer.Write(entity.targetZ, coordBits);
+        }
+        writer.Write(stateChanged, 1);
+        if (stateChanged) writer.Write(entity.state, 2);
+    }
+
+    // Colour never changes, so deltas carry it over from the baseline
+    void Read(BitReader& reader, NetEntity& entity, const NetEntity* base) const {
+        if (!base) {
+            entity.x = reader.Read(coordBits);
+            entity.z = reader.Read(coordBits);
+            entity.targetX = reader.Read(coordBits);
+            entity.targetZ = reader.Read(coordBits);
+            entity.state = (uint8_t)reader.Read(2);
+            uint32_t color = reader.Read(24);
+            entity.r = (uint8_t)color;
+            entity.g = (uint8_t)(color >> 8);
+            entity.b = (uint8_t)(color >> 16);
+            return;
+        }
+
+        entity = *base;
+        if (!reader.Read(1)) return;
+        if (reader.Read(1)) {
+            entity.x = ReadDelta(reader, base->x);
+            entity.z = ReadDelta(reader, base->z);
+        }
+        if (reader.Read(1)) {
+            entity.targetX = reader.Read(coordBits);
+            entity.targetZ = reader.Read(coordBits);
+        }
+        if (reader.Read(1)) entity.state = (uint8_t)reader.Read(2);
+    }
+
+    // Entity indices are sent as the gap from the previous one in the packet:
+    // one bit when consecutive, otherwise a 2-bit size class and 4/8/12/16 bits
+    void WriteIndex(BitWriter& writer, uint32_t index, int64_t previous) const {
+        static const int widths[4] = {4, 8, 12, 16};
+        uint32_t gap = (uint32_t)(index - previous - 1);
+        writer.Write(gap == 0, 1);
+        if (gap == 0) return;
+        int size = 0;
+        while (size < 3 && gap >= (1u << widths[size])) size++;
+        writer.Write(size, 2);
+        writer.Write(gap, widths[size]);
+    }
+
+    uint32_t ReadIndex(BitReader& reader, int64_t previous) const {
+        static const int widths[4] = {4, 8, 12, 16};
+        uint32_t gap = reader.Read(1) ? 0 : reader.Read(widths[reader.Read(2)]);
+        return (uint32_t)(previous + 1 + gap);
+    }
+
+    // Writes the entities `world[indices[k]]` for k from `first` on until
+    // the writer is full and returns the k past the last one written.
+    // `findBase(index)` gives the baseline entity or nullptr.
+    template <typename BaseLookup>
+    size_t WriteRange(BitWriter& writer, const std::vector<NetEntity>& world, const std::vector<uint32_t>& indices,
+                      size_t first, BaseLookup findBase) const {
+        int64_t previous = -1;
+        size_t k = first;
+        for (; k < indices.size(); k++) {
+            size_t mark = writer.GetBitCount();
+            WriteIndex(writer, indices[k], previous);
+            Write(writer, world[indices[k]], findBase(indices[k]));
+            if (writer.overflow) {
+                writer.Rewind(mark);
+                break;
+            }
+            previous = indices[k];
+        }
+        return k;
+    }
+
+    template <typename BaseLookup>
+    bool ReadRange(BitReader& reader, uint32_t* indices, NetEntity* entities, size_t count, BaseLookup findBase) const {
+        int64_t previous = -1;
+        for (size_t k = 0; k < count && !reader.error; k++) {
+            indices[k] = ReadIndex(reader, previous);
+            Read(reader, entities[k], findBase(indices[k]));
+            previous = indices[k];
+        }
+        return !reader.error;
+    }
+
+    // Largest error of a quantized coordinate, in world units
+    float GetPrecision() const { return 0.5f * CELL_SIZE / (1 << NET_OFFSET_BITS); }
+};
+
+// One tick of quantized world state, kept in a ring of NET_SNAPSHOT_HISTORY
+// as delta baselines. The server keeps every NPC (`entities` by NPC index);
+// a client keeps the NPCs it was sent, assembled from the snapshot's
+// packets, with their NPC indices in ascending order in `indices`.
+struct WorldSnapshot {
+    uint32_t tick = 0;
+    bool complete = false;
+    int received = 0;
+    std::vector<uint16_t> packetFirsts;     // ranges seen, to ignore duplicates
+    std::vector<uint32_t> indices;
+    std::vector<NetEntity> entities;
+
+    // Client side: the entity with NPC index `index`, if this snapshot has it
+    const NetEntity* Find(uint32_t index) const {
+        auto found = std::lower_bound(indices.begin(), indices.end(), index);
+        return found != indices.end() && *found == index ? &entities[found - indices.begin()] : nullptr;
+    }
+};
+
+// Authoritative game server: owns the maze, NPC AI and collision, runs
+// headless at a fixed tick and replicates snapshots to every client.
+// Each tick consumes at most one queued input per client, in sequence
+// order, and acknowledges the last one in that client's snapshots.
+class GameServer {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        double tickSeconds = 0.0;
+        double maxTickSeconds = 0.0;
+        std::vector<float> tickMs;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t packetsSent = 0;
+        uint64_t clientTicks = 0;       // sum over ticks of connected clients
+        uint64_t deltaSnapshots = 0;
+        uint64_t fullSnapshots = 0;
+        uint64_t entitiesSent = 0;
+        uint64_t entityBytes = 0;
+        double interestSeconds = 0.0;
+    };
+
+    // Off: every client receives every NPC
+    bool interestManagement = true;
+
+private:
+    struct Client {
+        NetAddress address;
+        uint16_t id;
+        Player player;
+        PlayerInput lastInput;
+        std::vector<PlayerInput> pendingInputs;
+        uint32_t ackedSnapshot;
+        double lastHeard;
+        // NPC indices sent in each recent snapshot, for delta baselines
+        uint32_t sentTicks[NET_SNAPSHOT_HISTORY];
+        std::vector<uint32_t> sentIndices[NET_SNAPSHOT_HISTORY];
+    };
+
+    MazeGenerator maze;
+    std::vector<NPC> npcs;
+    CrowdSeparation crowd;
+    SnapshotCodec codec;
+    WorldSnapshot history[NET_SNAPSHOT_HISTORY];
+
+    // NPCs bucketed by cell, moved incrementally as they cross cells
+    std::vector<std::vector<uint32_t>> cellNpcs;
+    std::vector<uint32_t> npcCell;
+    std::vector<uint32_t> npcSlot;          // position within its cell's bucket
+
+    // Scratch for the per-client corridor search
+    std::vector<uint32_t> visitStamp;
+    uint32_t stamp = 0;
+    std::vector<uint32_t> frontier;
+    std::vector<uint32_t> relevant;
+    std::vector<Client> clients;
+    uint32_t mazeSeed = 0;
+    uint32_t tick = 0;
+    uint16_t nextClientId = 1;
+    double clock = 0.0;
+    double lastTickUs = 0.0;        // reported to clients in snapshots
+    Stats stats;
+
+#ifdef MAZE_HAS_NETWORK
+    UdpSocket socket;
+#endif
+
+    Client* FindClient(const NetAddress& address) {
+        for (auto& client : clients) {
+            if (client.address == address) return &client;
+        }
+        return nullptr;
+    }
+
+    void SendPacket(const NetAddress& to, const PacketWriter& writer) {
+#ifdef MAZE_HAS_NETWORK
+        socket.Send(to, writer.GetData(), writer.GetSize());
+#endif
+        stats.bytesSent += writer.GetSize();
+        stats.packetsSent++;
+    }
+
+    void HandlePacket(const NetAddress& from, const uint8_t* data, int size) {
+        stats.bytesReceived += size;
+        PacketReader reader(data, size);
+        uint8_t type = reader.U8();
+        Client* client = FindClient(from);
+
+        if (type == PACKET_CONNECT) {
+            if (reader.U8() != NET_PROTOCOL_VERSION) return;
+            if (!client) {
+                if ((int)clients.size() >= NET_MAX_CLIENTS) return;
+                Client added = {};
+                added.address = from;
+                added.id = nextClientId++;
+                added.player.position = maze.GetRandomSpawnPosition();
+                clients.push_back(added);
+                client = &clients.back();
+            }
+            client->lastHeard = clock;
+
+            // Resent for every CONNECT, in case the previous WELCOME was lost
+            PacketWriter writer;
+            writer.U8(PACKET_WELCOME);
+            writer.U16(client->id);
+            writer.U32(mazeSeed);
+            writer.U16((uint16_t)maze.GetWidth());
+            writer.U16((uint16_t)maze.GetHeight());
+            writer.U16(SERVER_TICK_RATE);
+            SendPacket(from, writer);
+        }
+        else if (type == PACKET_INPUT && client) {
+            client->lastHeard = clock;
+            client->ackedSnapshot = std::max(client->ackedSnapshot, reader.U32());
+            int count = reader.U8();
+            for (int i = 0; i < count; i++) {
+                PlayerInput input;
+                input.sequence = reader.U32();
+                input.yaw = reader.F32();
+                input.pitch = Clamp(reader.F32(), -1.5f, 1.5f);
+                input.buttons = reader.U8();
+                if (reader.error) break;
+                // Redundant copies of inputs already queued or applied are dropped
+                if (input.sequence <= client->lastInput.sequence) continue;
+                auto slot = std::lower_bound(
+                    client->pendingInputs.begin(), client->pendingInputs.end(), input.sequence,
+                    [](const PlayerInput& pending, uint32_t sequence) { return pending.sequence < sequence; });
+                if (slot == client->pendingInputs.end() || slot->sequence != input.sequence) {
+                    client->pendingInputs.insert(slot, input);
+                }
+            }
+            // A client sending faster than the tick rate loses its oldest inputs
+            // rather than growing the queue and its own input latency
+            if (client->pendingInputs.size() > NET_MAX_PENDING_INPUTS) {
+                client->pendingInputs.erase(client->pendingInputs.begin(),
+                                            client->pendingInputs.end() - NET_MAX_PENDING_INPUTS);
+            }
+        }
+        else if (type == PACKET_DISCONNECT && client) {
+            client->lastHeard = -NET_CLIENT_TIMEOUT;
+        }
+    }
+
+    Vector3 NearestPlayer(Vector3 position) const {
+        Vector3 nearest = {1e9f, 0.0f, 1e9f};
+        float best = 1e30f;
+        for (const auto& client : clients) {
+            float dx = client.player.position.x - position.x;
+            float dz = client.player.position.z - position.z;
+            float distance = dx * dx + dz * dz;
+            if (distance < best) {
+                best = distance;
+                nearest = client.player.position;
+            }
+        }
+        return nearest;
+    }
+
+    uint32_t CellOf(Vector3 position) const {
+        int x = std::max(0, std::min(maze.GetWidth() - 1, (int)((position.x + CELL_SIZE / 2) / CELL_SIZE)));
+        int y = std::max(0, std::min(maze.GetHeight() - 1, (int)((position.z + CELL_SIZE / 2) / CELL_SIZE)));
+        return (uint32_t)(x * maze.GetHeight() + y);
+    }
+
+    void MoveToCell(uint32_t npc, uint32_t cell) {
+        std::vector<uint32_t>& from = cellNpcs[npcCell[npc]];
+        uint32_t last = from.back();
+        from[npcSlot[npc]] = last;
+        npcSlot[last] = npcSlot[npc];
+        from.pop_back();
+
+        npcCell[npc] = cell;
+        npcSlot[npc] = (uint32_t)cellNpcs[cell].size();
+        cellNpcs[cell].push_back(npc);
+    }
+
+    // Fills `relevant` with the sorted indices of NPCs the client should
+    // receive: those within NET_INTEREST_DEPTH cells of corridor (a search
+    // through open walls) or in view down a straight corridor. The cost
+    // depends on the cells searched and NPCs found, not the NPC total.
+    void GatherRelevant(const Client& client) {
+        relevant.clear();
+        if (!interestManagement) {
+            for (uint32_t i = 0; i < npcs.size(); i++) relevant.push_back(i);
+            return;
+        }
+
+        const int height = maze.GetHeight();
+        if (++stamp == 0) {
+            std::fill(visitStamp.begin(), visitStamp.end(), 0);
+            stamp = 1;
+        }
+        auto visit = [&](uint32_t cell) {
+            if (visitStamp[cell] == stamp) return false;
+            visitStamp[cell] = stamp;
+            relevant.insert(relevant.end(), cellNpcs[cell].begin(), cellNpcs[cell].end());
+            return true;
+        };
+
+        uint32_t start = CellOf(client.player.position);
+        frontier.clear();
+        frontier.push_back(start);
+        visit(start);
+        size_t levelStart = 0;
+        for (int depth = 0; depth < NET_INTEREST_DEPTH; depth++) {
+            size_t levelEnd = frontier.size();
+            for (size_t f = levelStart; f < levelEnd; f++) {
+                int x = (int)(frontier[f] / height), y = (int)(frontier[f] % height);
+                Cell* cell = maze.GetCell(x, y);
+                for (int side = 0; side < 4; side++) {
+                    if (cell->walls[side]) continue;
+                    uint32_t next = (uint32_t)((x + SIDE_DX[side]) * height + y + SIDE_DY[side]);
+                    if (visit(next)) frontier.push_back(next);
+                }
+            }
+            levelStart = levelEnd;
+        }
+
+        // Straight sight lines beyond the search
+        int startX = (int)(start / height), startY = (int)(start % height);
+        for (int side = 0; side < 4; side++) {
+            int x = startX, y = startY;
+            for (int step = 0; step < NET_INTEREST_SIGHT && !maze.GetCell(x, y)->walls[side]; step++) {
+                x += SIDE_DX[side];
+                y += SIDE_DY[side];
+                visit((uint32_t)(x * height + y));
+            }
+        }
+        std::sort(relevant.begin(), relevant.end());
+    }
+
+    void Simulate(float dt) {
+        for (auto& client : clients) {
+            if (!client.pendingInputs.empty()) {
+                client.lastInput = client.pendingInputs.front();
+                client.pendingInputs.erase(client.pendingInputs.begin());
+            }
+            // Without new input the last one is held (movement keys stay down)
+            ApplyPlayerInput(client.player, maze, client.lastInput, dt);
+        }
+
+        for (auto& npc : npcs) {
+            npc.Think(maze, NearestPlayer(npc.position), dt);
+            npc.Update(maze, dt);
+        }
+        crowd.Apply(maze, npcs);
+        for (uint32_t i = 0; i < npcs.size(); i++) {
+            uint32_t cell = CellOf(npcs[i].position);
+            if (cell != npcCell[i]) MoveToCell(i, cell);
+        }
+    }
+
+    // The NET_SNAPSHOT_PLAYERS police nearest to `client` (itself first)
+    void SelectPlayers(const Client& client, std::vector<const Client*>& selected) const {
+        selected.clear();
+        for (const auto& other : clients) selected.push_back(&other);
+        auto closer = [&](const Client* a, const Client* b) {
+            return Vector3Distance(a->player.position, client.player.position) <
+                   Vector3Distance(b->player.position, client.player.position);
+        };
+        if (selected.size() > (size_t)NET_SNAPSHOT_PLAYERS) {
+            std::nth_element(selected.begin(), selected.begin() + NET_SNAPSHOT_PLAYERS, selected.end(), closer);
+            selected.resize(NET_SNAPSHOT_PLAYERS);
+        }
+    }
+
+    // Quantizes this tick's NPCs into the history ring
+    void CaptureSnapshot() {
+        WorldSnapshot& snapshot = history[tick % NET_SNAPSHOT_HISTORY];
+        snapshot.tick = tick;
+        snapshot.entities.resize(npcs.size());
+        for (size_t i = 0; i < npcs.size(); i++) snapshot.entities[i] = codec.Quantize(npcs[i]);
+    }
+
+    // The client's acked snapshot if it is still in the ring
+    const WorldSnapshot* FindBaseline(const Client& client) const {
+        uint32_t acked = client.ackedSnapshot;
+        if (acked == 0 || tick - acked >= (uint32_t)NET_SNAPSHOT_HISTORY) return nullptr;
+        int slot = acked % NET_SNAPSHOT_HISTORY;
+        const WorldSnapshot& snapshot = history[slot];
+        if (snapshot.tick != acked || client.sentTicks[slot] != acked || snapshot.entities.size() != npcs.size()) {
+            return nullptr;
+        }
+        return &snapshot;
+    }
+
+    // The NPCs relevant to the client are delta-encoded against its last
+    // acked snapshot (NPCs it didn't have then are sent in full) and split
+    // over as many packets as needed. Each packet carries a contiguous run
+    // of the relevant list and decodes on its own; players ride in the first.
+    void SendSnapshot(Client& client) {
+        std::vector<const Client*> selected;
+        SelectPlayers(client, selected);
+        const WorldSnapshot& current = history[tick % NET_SNAPSHOT_HISTORY];
+        const WorldSnapshot* baseline = FindBaseline(client);
+        (baseline ? stats.deltaSnapshots : stats.fullSnapshots)++;
+
+        auto interestStart = std::chrono::steady_clock::now();
+        GatherRelevant(client);
+        stats.interestSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - interestStart).count();
+
+        const std::vector<uint32_t>* baseIndices = baseline ? &client.sentIndices[baseline->tick % NET_SNAPSHOT_HISTORY] : nullptr;
+        auto findBase = [&](uint32_t index) -> const NetEntity* {
+            if (!baseIndices || !std::binary_search(baseIndices->begin(), baseIndices->end(), index)) return nullptr;
+            return &baseline->entities[index];
+        };
+
+        size_t entry = 0;
+        do {
+            PacketWriter writer;
+            writer.U8(PACKET_SNAPSHOT);
+            writer.U32(tick);
+            writer.U32(baseline ? baseline->tick : 0);
+            writer.U32(client.lastInput.sequence);
+            writer.U16((uint16_t)std::min(65535.0, lastTickUs));
+            size_t playerCount = entry == 0 ? selected.size() : 0;
+            writer.U16((uint16_t)playerCount);
+            for (size_t i = 0; i < playerCount; i++) {
+                writer.U16(selected[i]->id);
+                writer.F32(selected[i]->player.position.x);
+                writer.F32(selected[i]->player.position.z);
+                writer.F32(selected[i]->player.yaw);
+            }
+
+            writer.U16((uint16_t)relevant.size());
+            writer.U16((uint16_t)entry);
+            BitWriter bits(writer.Remaining() - 4);
+            size_t end = codec.WriteRange(bits, current.entities, relevant, entry, findBase);
+            writer.U16((uint16_t)(end - entry));
+            writer.U16((uint16_t)bits.GetSize());
+            writer.Bytes(bits.GetData(), bits.GetSize());
+            stats.entitiesSent += end - entry;
+            stats.entityBytes += bits.GetSize();
+            entry = end;
+            SendPacket(client.address, writer);
+        } while (entry < relevant.size());
+
+        int slot = tick % NET_SNAPSHOT_HISTORY;
+        client.sentTicks[slot] = tick;
+        client.sentIndices[slot].assign(relevant.begin(), relevant.end());
+    }
+
+public:
+    bool Start(uint16_t port, uint32_t seed, int mazeWidth, int mazeHeight, int npcCount, bool loopbackOnly = false) {
+        mazeSeed = seed;
+        maze.Seed(seed);
+        maze.Initialize(mazeWidth, mazeHeight);
+        maze.Generate();
+        codec.Configure(mazeWidth, mazeHeight);
+
+        if (npcCount > NET_MAX_NPCS) {
+            TraceLog(LOG_WARNING, "NET: %d NPCs do not fit a snapshot, serving %d", npcCount, NET_MAX_NPCS);
+            npcCount = NET_MAX_NPCS;
+        }
+        npcs.clear();
+        for (int i = 0; i < npcCount; i++) {
+            NPC npc;
+            npc.position = maze.GetRandomSpawnPosition();
+            npc.target = maze.GetRandomSpawnPosition();
+            npc.color = (Color){(unsigned char)(maze.Random(200) + 55),
+                               (unsigned char)(maze.Random(200) + 55),
+                               (unsigned char)(maze.Random(200) + 55), 255};
+            npcs.push_back(npc);
+        }
+
+        cellNpcs.assign((size_t)mazeWidth * mazeHeight, {});
+        visitStamp.assign((size_t)mazeWidth * mazeHeight, 0);
+        npcCell.resize(npcs.size());
+        npcSlot.resize(npcs.size());
+        for (uint32_t i = 0; i < npcs.size(); i++) {
+            npcCell[i] = CellOf(npcs[i].position);
+            npcSlot[i] = (uint32_t)cellNpcs[npcCell[i]].size();
+            cellNpcs[npcCell[i]].push_back(i);
+        }
+
+#ifdef MAZE_HAS_NETWORK
+        return socket.Open(port, loopbackOnly);
+#else
+        (void)port; (void)loopbackOnly;
+        TraceLog(LOG_ERROR, "NET: Networking is not available on this platform");
+        return false;
+#endif
+    }
+
+    uint16_t GetPort() const {
+#ifdef MAZE_HAS_NETWORK
+        return socket.GetPort();
+#else
+        return 0;
+#endif
+    }
+
+    // One fixed-rate tick: receive, simulate, replicate
+    void Tick() {
+        MemoryScope scope(MemoryTag::NETWORK);
+        auto tickStart = std::chrono::steady_clock::now();
+        const float dt = 1.0f / SERVER_TICK_RATE;
+        clock += dt;
+        tick++;
+
+#ifdef MAZE_HAS_NETWORK
+        uint8_t buffer[NET_MAX_PACKET];
+        NetAddress from;
+        int size;
+        while ((size = socket.Receive(from, buffer, sizeof(buffer))) >= 0) {
+            HandlePacket(from, buffer, size);
+        }
+#endif
+
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [&](const Client& c) { return clock - c.lastHeard > NET_CLIENT_TIMEOUT; }),
+                      clients.end());
+
+        Simulate(dt);
+        CaptureSnapshot();
+        for (auto& client : clients) SendSnapshot(client);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tickStart).count();
+        stats.ticks++;
+        stats.tickSeconds += seconds;
+        stats.maxTickSeconds = std::max(stats.maxTickSeconds, seconds);
+        stats.tickMs.push_back((float)(seconds * 1000.0));
+        lastTickUs = seconds * 1e6;
+        stats.clientTicks += clients.size();
+    }
+
+    // Tick at SERVER_TICK_RATE until `stop` is set or `seconds` have passed (<= 0: forever)
+    void Run(const std::atomic<bool>& stop, double seconds = 0.0) {
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / SERVER_TICK_RATE));
+        auto start = std::chrono::steady_clock::now();
+        auto next = start;
+        while (!stop.load()) {
+            if (seconds > 0.0 && std::chrono::duration<double>(next - start).count() >= seconds) break;
+            Tick();
+            next += period;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    int GetClientCount() const { return (int)clients.size(); }
+    int GetNpcCount() const { return (int)npcs.size(); }
+    const Stats& GetStats() const { return stats; }
+
+    void PrintStats(FILE* out) const {
+        if (stats.ticks == 0) return;
+        std::vector<float> sorted = stats.tickMs;
+        std::sort(sorted.begin(), sorted.end());
+        double seconds = (double)stats.ticks / SERVER_TICK_RATE;
+        double clientSeconds = (double)stats.clientTicks / SERVER_TICK_RATE;
+        fprintf(out, "Server: %llu ticks at %d Hz, %d NPCs, %d clients connected at end\n",
+                (unsigned long long)stats.ticks, SERVER_TICK_RATE, (int)npcs.size(), (int)clients.size());
+        fprintf(out, "  tick cost: avg %.3f ms, p50 %.3f ms, p99 %.3f ms, max %.3f ms (budget %.2f ms)\n",
+                stats.tickSeconds * 1000.0 / stats.ticks, sorted[sorted.size() / 2],
+                sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)], stats.maxTickSeconds * 1000.0,
+                1000.0 / SERVER_TICK_RATE);
+        if (clientSeconds > 0.0) {
+            fprintf(out, "  bandwidth per client: down %.1f KB/s (%.0f B/tick), up %.1f KB/s\n",
+                    stats.bytesSent / clientSeconds / 1024.0, (double)stats.bytesSent / stats.clientTicks,
+                    stats.bytesReceived / clientSeconds / 1024.0);
+        }
+        if (stats.entitiesSent > 0) {
+            fprintf(out, "  snapshots: %.1f%% delta, %.2f B per NPC (%d naive)\n",
+                    100.0 * stats.deltaSnapshots / std::max<uint64_t>(1, stats.deltaSnapshots + stats.fullSnapshots),
+                    (double)stats.entityBytes / stats.entitiesSent, NET_NAIVE_NPC_BYTES);
+        }
+        if (stats.clientTicks > 0) {
+            fprintf(out, "  interest: %s, %.1f of %d NPCs sent per client, %.2f us per client per tick\n",
+                    interestManagement ? "corridor search" : "off", (double)stats.entitiesSent / stats.clientTicks,
+                    (int)npcs.size(), stats.interestSeconds * 1e6 / stats.clientTicks);
+        }
+        fprintf(out, "  total: %.1f s, %llu packets sent\n", seconds, (unsigned long long)stats.packetsSent);
+    }
+};
+
+// Client side of the protocol, shared by the windowed game and bots: connects,
+// sends inputs (with the previous ones repeated against loss) and keeps the
+// latest replicated world state.
+class GameClient {
+public:
+    struct Stats {
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        uint64_t snapshotPackets = 0;
+        uint64_t snapshots = 0;         // complete ones
+        uint32_t firstTick = 0;
+        uint32_t lastTick = 0;
+        // Arrival time minus tick time of each complete snapshot, relative to
+        // the first; less the minimum, this is the delay past the best case
+        double arrivalBase = 0.0;
+        std::vector<float> arrivalOffsets;
+    };
+
+    bool connected = false;
+    uint16_t clientId = 0;
+    uint32_t mazeSeed = 0;
+    int mazeWidth = 0;
+    int mazeHeight = 0;
+    int tickRate = SERVER_TICK_RATE;
+
+    uint32_t snapshotTick = 0;
+    uint16_t serverTickUs = 0;          // the server's cost for its previous tick
+    bool recordArrivals = false;        // keep Stats::arrivalOffsets (load tests)
+    FrameArena* frameArena = nullptr;   // scratch for decoding snapshots (null: the heap)
+    uint32_t ackedInput = 0;
+    std::vector<NetPlayer> players;
+    std::vector<NPC> npcs;
+
+    // This client's own player as of the newest snapshot, with the last
+    // input the server had applied to it (for prediction)
+    uint32_t selfTick = 0;
+    uint32_t selfInput = 0;
+    Vector3 selfPosition = {0.0f, 0.0f, 0.0f};
+
+private:
+    NetAddress server;
+    SnapshotCodec codec;
+    WorldSnapshot history[NET_SNAPSHOT_HISTORY];
+    uint32_t ackedSnapshot = 0;         // newest complete snapshot
+    double lastConnectAttempt = -1e9;
+    static const int INPUT_REDUNDANCY = 3;
+    PlayerInput recentInputs[INPUT_REDUNDANCY] = {};
+    int recentCount = 0;
+    double clock = 0.0;             // `now` of the last Update
+    LinkSimulator outgoing;
+    LinkSimulator incoming;
+    Stats stats;
+
+#ifdef MAZE_HAS_NETWORK
+    UdpSocket socket;
+#endif
+
+    void Send(const PacketWriter& writer) {
+        stats.bytesSent += writer.GetSize();
+        if (outgoing.IsActive()) {
+            outgoing.Push(clock, writer.GetData(), writer.GetSize());
+            return;
+        }
+#ifdef MAZE_HAS_NETWORK
+        socket.Send(server, writer.GetData(), writer.GetSize());
+#endif
+    }
+
+    void HandlePacket(const uint8_t* data, size_t size) {
+        PacketReader reader(data, size);
+        uint8_t type = reader.U8();
+        if (type == PACKET_WELCOME && !connected) {
+            clientId = reader.U16();
+            mazeSeed = reader.U32();
+            mazeWidth = reader.U16();
+            mazeHeight = reader.U16();
+            tickRate = reader.U16();
+            connected = !reader.error;
+            codec.Configure(mazeWidth, mazeHeight);
+        }
+        else if (type == PACKET_SNAPSHOT && connected) {
+            HandleSnapshot(reader);
+        }
+    }
+
+    void HandleSnapshot(PacketReader& reader) {
+        uint32_t tick = reader.U32();
+        uint32_t baselineTick = reader.U32();
+        uint32_t ack = reader.U32();
+        uint16_t tickUs = reader.U16();
+        if (tick <= ackedSnapshot) return;   // stale or duplicate
+
+        FrameVector<NetPlayer> received(reader.U16(), FrameAllocator<NetPlayer>(frameArena));
+        for (auto& player : received) {
+            player.id = reader.U16();
+            player.position = {reader.F32(), PLAYER_HEIGHT / 2, 0.0f};
+            player.position.z = reader.F32();
+            player.yaw = reader.F32();
+        }
+        uint16_t entryTotal = reader.U16();
+        uint16_t first = reader.U16();
+        uint16_t count = reader.U16();
+        uint16_t byteCount = reader.U16();
+        const uint8_t* bytes = reader.Bytes(byteCount);
+        if (reader.error || first + count > entryTotal) return;
+
+        // Packets whose baseline has left the ring (or never arrived) can't be decoded
+        const WorldSnapshot* baseline = nullptr;
+        if (baselineTick != 0) {
+            baseline = &history[baselineTick % NET_SNAPSHOT_HISTORY];
+            if (baseline->tick != baselineTick || !baseline->complete) return;
+        }
+
+        WorldSnapshot& snapshot = history[tick % NET_SNAPSHOT_HISTORY];
+        if (snapshot.tick != tick) {
+            snapshot.tick = tick;
+            snapshot.complete = false;
+            snapshot.received = 0;
+            snapshot.packetFirsts.clear();
+            snapshot.indices.resize(entryTotal);
+            snapshot.entities.resize(entryTotal);
+        }
+        if (snapshot.complete || snapshot.entities.size() != entryTotal) return;
+        for (uint16_t seen : snapshot.packetFirsts) {
+            if (seen == first) return;
+        }
+        BitReader bits(bytes, byteCount);
+        auto findBase = [&](uint32_t index) { return baseline ? baseline->Find(index) : nullptr; };
+        if (!codec.ReadRange(bits, &snapshot.indices[first], &snapshot.entities[first], count, findBase)) return;
+        snapshot.packetFirsts.push_back(first);
+        snapshot.received += count;
+
+        if (stats.snapshotPackets == 0) stats.firstTick = tick;
+        stats.snapshotPackets++;
+        stats.lastTick = std::max(stats.lastTick, tick);
+        ackedInput = std::max(ackedInput, ack);
+        if (first == 0 && tick >= snapshotTick) {
+            for (const auto& player : received) {
+                if (player.id != clientId || tick <= selfTick) continue;
+                selfTick = tick;
+                selfInput = ack;
+                selfPosition = player.position;
+            }
+            players.assign(received.begin(), received.end());
+        }
+
+        // The client's NPCs are the ones it was sent (those relevant to it)
+        if (snapshot.received >= entryTotal) {
+            snapshot.complete = true;
+            stats.snapshots++;
+            ackedSnapshot = tick;
+            snapshotTick = tick;
+            serverTickUs = tickUs;
+            if (recordArrivals) {
+                double offset = clock - (double)tick / tickRate;
+                if (stats.arrivalOffsets.empty()) stats.arrivalBase = offset;
+                stats.arrivalOffsets.push_back((float)(offset - stats.arrivalBase));
+            }
+            npcs.resize(entryTotal);
+            for (size_t i = 0; i < entryTotal; i++) codec.Dequantize(snapshot.entities[i], npcs[i]);
+        }
+    }
+
+public:
+    bool Open(const NetAddress& serverAddress) {
+        server = serverAddress;
+#ifdef MAZE_HAS_NETWORK
+        return socket.Open(0);
+#else
+        TraceLog(LOG_ERROR, "NET: Networking is not available on this platform");
+        return false;
+#endif
+    }
+
+    // Delay, jitter and drop this client's packets in both directions
+    void SetLinkConditions(const LinkConditions& link, uint64_t seed) {
+        outgoing.Configure(link, seed * 2 + 1);
+        incoming.Configure(link, seed * 2 + 2);
+    }
+
+    // Call every frame/tick with a monotonic clock in seconds
+    void Update(double now) {
+        MemoryScope scope(MemoryTag::NETWORK);
+        clock = now;
+        if (!connected && now - lastConnectAttempt >= NET_CONNECT_RETRY) {
+            lastConnectAttempt = now;
+            PacketWriter writer;
+            writer.U8(PACKET_CONNECT);
+            writer.U8(NET_PROTOCOL_VERSION);
+            Send(writer);
+        }
+
+#ifdef MAZE_HAS_NETWORK
+        outgoing.Deliver(now, [&](const uint8_t* data, size_t size) { socket.Send(server, data, size); });
+
+        uint8_t buffer[NET_MAX_PACKET];
+        NetAddress from;
+        int size;
+        while ((size = socket.Receive(from, buffer, sizeof(buffer))) >= 0) {
+            if (!(from == server)) continue;
+            stats.bytesReceived += size;
+            if (incoming.IsActive()) incoming.Push(now, buffer, size);
+            else HandlePacket(buffer, size);
+        }
+        incoming.Deliver(now, [&](const uint8_t* data, size_t size) { HandlePacket(data, size); });
+#endif
+    }
+
+    void SendInput(const PlayerInput& input) {
+        if (!connected) return;
+        for (int i = INPUT_REDUNDANCY - 1; i > 0; i--) recentInputs[i] = recentInputs[i - 1];
+        recentInputs[0] = input;
+        recentCount = std::min(recentCount + 1, INPUT_REDUNDANCY);
+
+        PacketWriter writer;
+        writer.U8(PACKET_INPUT);
+        writer.U32(ackedSnapshot);
+        writer.U8((uint8_t)recentCount);
+        for (int i = 0; i < recentCount; i++) {
+            writer.U32(recentInputs[i].sequence);
+            writer.F32(recentInputs[i].yaw);
+            writer.F32(recentInputs[i].pitch);
+            writer.U8(recentInputs[i].buttons);
+        }
+        Send(writer);
+    }
+
+    void Disconnect() {
+        if (!connected) return;
+        PacketWriter writer;
+        writer.U8(PACKET_DISCONNECT);
+        Send(writer);
+        connected = false;
+#ifdef MAZE_HAS_NETWORK
+        // Anything the link simulator still holds goes out now
+        outgoing.Deliver(1e30, [&](const uint8_t* data, size_t size) { socket.Send(server, data, size); });
+#endif
+    }
+
+    const NetPlayer* FindPlayer(uint16_t id) const {
+        for (const auto& player : players) {
+            if (player.id == id) return &player;
+        }
+        return nullptr;
+    }
+
+    const Stats& GetStats() const { return stats; }
+
+    int GetHandle() const {
+#ifdef MAZE_HAS_NETWORK
+        return socket.GetHandle();
+#else
+        return -1;
+#endif
+    }
+};
+
+// Client-side prediction of the local police player. Inputs are applied
+// at once with the server's tick length (the same ApplyPlayerInput and
+// wall collision the server runs) and kept in a ring until acknowledged.
+// Each new snapshot resets the player to the server's position after the
+// acked input and replays the newer inputs on top. Whatever that moves the
+// prediction by is a correction; it is folded into a render offset that
+// decays over a few frames instead of snapping the camera.
+class PlayerPrediction {
+public:
+    struct Stats {
+        uint64_t reconciles = 0;
+        uint64_t resets = 0;                // acked input older than the ring
+        std::vector<float> corrections;     // distance per reconcile
+    };
+
+private:
+    static const int INPUT_HISTORY = 256;
+    PlayerInput inputs[INPUT_HISTORY] = {};
+    uint32_t newestInput = 0;
+    uint32_t reconciledTick = 0;
+    Player player = {};
+    Vector3 renderOffset = {0.0f, 0.0f, 0.0f};
+    bool initialized = false;
+    Stats stats;
+
+public:
+    // Apply and remember one input of one server tick. Before the first
+    // snapshot there is no position to move, so inputs are only remembered
+    // and the first Reconcile replays them.
+    void Apply(MazeGenerator& maze, const PlayerInput& input, float tickSeconds) {
+        inputs[input.sequence % INPUT_HISTORY] = input;
+        newestInput = input.sequence;
+        if (!initialized) return;
+        ApplyPlayerInput(player, maze, input, tickSeconds);
+        renderOffset = Vector3Scale(renderOffset, 0.85f);
+    }
+
+    void Reconcile(MazeGenerator& maze, Vector3 serverPosition, uint32_t ackedInput, uint32_t serverTick,
+                   float tickSeconds) {
+        if (serverTick <= reconciledTick) return;
+        reconciledTick = serverTick;
+        Vector3 predicted = player.position;
+        float yaw = player.yaw, pitch = player.pitch;
+
+        player.position = serverPosition;
+        if (newestInput - ackedInput >= (uint32_t)INPUT_HISTORY || ackedInput > newestInput) {
+            stats.resets++;
+        }
+        else {
+            for (uint32_t sequence = ackedInput + 1; sequence <= newestInput; sequence++) {
+                ApplyPlayerInput(player, maze, inputs[sequence % INPUT_HISTORY], tickSeconds);
+            }
+        }
+        player.yaw = yaw;
+        player.pitch = pitch;
+
+        if (!initialized) {
+            initialized = true;
+            return;
+        }
+        Vector3 correction = Vector3Subtract(player.position, predicted);
+        renderOffset = Vector3Subtract(renderOffset, correction);
+        stats.reconciles++;
+        stats.corrections.push_back(Vector3Length(correction));
+    }
+
+    bool IsInitialized() const { return initialized; }
+    const Player& GetPlayer() const { return player; }
+    Vector3 GetRenderPosition() const { return Vector3Add(player.position, renderOffset); }
+    const Stats& GetStats() const { return stats; }
+};
+
+// The maze contracted to its junctions and dead ends. Most cells of a
+// generated maze have exactly two open sides. Each run of such corridor
+// cells becomes one edge, weighted by its length, between the nodes at its
+// ends, so a search visits nodes instead of cells. Every cell maps to its
+// node, or to its edge plus its offset along the edge from node `a`.
+// Searches are A* toward one cell (Manhattan distance is a consistent
+// bound, since every step is one cell) or Dijkstra toward the nearest of
+// several.
+class CorridorGraph {
+public:
+    struct Edge {
+        int a;
+        int b;
+        int length;             // steps from a to b
+        uint32_t firstCell;     // the length - 1 interior cells, a to b, start here in corridorCells
+    };
+
+private:
+    // A search result: the path runs back from `node` through the parent
+    // edges, then along `edge` from its offset `entry` (0 or length) to
+    // `offset`. With node -1 it runs along the start cell's own edge.
+    struct Arrival {
+        int cost = INT32_MAX;
+        int node = -1;
+        int edge = -1;
+        int entry = 0;
+        int offset = 0;
+    };
+
+    int width = 0;
+    int height = 0;
+    std::vector<int> nodeCell;              // per node
+    LargeVector<int, MemoryTag::NAV> cellNode;      // per cell: its node, -1 in a corridor
+    LargeVector<int, MemoryTag::NAV> cellEdge;      // per cell: its edge, -1 at a node
+    LargeVector<int, MemoryTag::NAV> cellOffset;    // per corridor cell: steps from its edge's a
+    std::vector<Edge> edges;
+    std::vector<int> corridorCells;
+    std::vector<uint32_t> adjacencyStart;   // per node + 1
+    std::vector<int> adjacency;             // edge ids
+
+    // Search scratch, stamped so nothing is cleared between queries
+    std::vector<int> cost;                  // per node
+    std::vector<int> parentEdge;            // per node, -1 at a start node
+    std::vector<int> startExit;             // per start node: the offset it sits at on the start edge
+    std::vector<uint32_t> nodeStamp;
+    std::vector<uint32_t> goalNodeStamp;
+    std::vector<uint32_t> goalEdgeStamp;    // per edge
+    std::vector<int> goalMin;               // per edge: goal offsets nearest a and nearest b
+    std::vector<int> goalMax;
+    std::vector<std::pair<int, int>> heap;  // (-(cost + bound), node)
+    uint32_t currentStamp = 0;
+
+    int CellAt(const Edge& edge, int offset) const {
+        if (offset == 0) return nodeCell[edge.a];
+        if (offset == edge.length) return nodeCell[edge.b];
+        return corridorCells[edge.firstCell + offset - 1];
+    }
+
+    // Appends the cells after `from` up to and including `to` along an edge
+    void AppendWalk(int edge, int from, int to, std::vector<int>& path) const {
+        int step = to > from ? 1 : -1;
+        for (int offset = from; offset != to; ) {
+            offset += step;
+            path.push_back(CellAt(edges[edge], offset));
+        }
+    }
+
+    int AddNode(int cell) {
+        cellNode[cell] = (int)nodeCell.size();
+        nodeCell.push_back(cell);
+        return cellNode[cell];
+    }
+
+    // Follows the corridor leaving `node` by `side` to the next node,
+    // adding its edge unless it was already found from the other end
+    void Walk(MazeGenerator& maze, int node, int side) {
+        int previous = nodeCell[node];
+        int current = previous + SIDE_DX[side] * height + SIDE_DY[side];
+        if (cellNode[current] >= 0) {
+            if (node < cellNode[current]) edges.push_back({node, cellNode[current], 1, (uint32_t)corridorCells.size()});
+            return;
+        }
+        if (cellEdge[current] >= 0) return;
+
+        int edge = (int)edges.size();
+        edges.push_back({node, -1, 0, (uint32_t)corridorCells.size()});
+        int steps = 1;
+        while (cellNode[current] < 0) {
+            cellEdge[current] = edge;
+            cellOffset[current] = steps;
+            corridorCells.push_back(current);
+            Cell* cell = maze.GetCell(current / height, current % height);
+            for (int next = 0; next < 4; next++) {
+                int neighbour = current + SIDE_DX[next] * height + SIDE_DY[next];
+                if (cell->walls[next] || neighbour == previous) continue;
+                previous = current;
+                current = neighbour;
+                break;
+            }
+            steps++;
+        }
+        edges[edge].b = cellNode[current];
+        edges[edge].length = steps;
+    }
+
+    Arrival Search(int from, const int* goals, size_t goalCount, int target) {
+        MemoryScope scope(MemoryTag::NAV);
+        Arrival best;
+        if (++currentStamp == 0) {
+            std::fill(nodeStamp.begin(), nodeStamp.end(), 0);
+            std::fill(goalNodeStamp.begin(), goalNodeStamp.end(), 0);
+            std::fill(goalEdgeStamp.begin(), goalEdgeStamp.end(), 0);
+            currentStamp = 1;
+        }
+        int fromEdge = cellEdge[from];
+        int fromOffset = fromEdge >= 0 ? cellOffset[from] : 0;
+        for (size_t i = 0; i < goalCount; i++) {
+            int goal = goals[i];
+            if (goal == from) {
+                best.cost = 0;
+                best.offset = fromOffset;
+                return best;
+            }
+            int edge = cellEdge[goal];
+            if (edge < 0) {
+                goalNodeStamp[cellNode[goal]] = currentStamp;
+                continue;
+            }
+            int offset = cellOffset[goal];
+            if (goalEdgeStamp[edge] != currentStamp) {
+                goalEdgeStamp[edge] = currentStamp;
+                goalMin[edge] = goalMax[edge] = offset;
+            }
+            goalMin[edge] = std::min(goalMin[edge], offset);
+            goalMax[edge] = std::max(goalMax[edge], offset);
+            // Straight along the start cell's own edge
+            if (edge == fromEdge && abs(offset - fromOffset) < best.cost) {
+                best.cost = abs(offset - fromOffset);
+                best.offset = offset;
+            }
+        }
+
+        const int targetX = target >= 0 ? target / height : 0;
+        const int targetY = target >= 0 ? target % height : 0;
+        auto bound = [&](int node) {
+            if (target < 0) return 0;
+            return abs(nodeCell[node] / height - targetX) + abs(nodeCell[node] % height - targetY);
+        };
+        heap.clear();
+        auto open = [&](int node, int nodeCost, int edge) {
+            if (nodeStamp[node] == currentStamp && cost[node] <= nodeCost) return;
+            nodeStamp[node] = currentStamp;
+            cost[node] = nodeCost;
+            parentEdge[node] = edge;
+            heap.push_back({-(nodeCost + bound(node)), node});
+            std::push_heap(heap.begin(), heap.end());
+        };
+        if (fromEdge < 0) {
+            open(cellNode[from], 0, -1);
+            startExit[cellNode[from]] = 0;
+        }
+        else {
+            const Edge& edge = edges[fromEdge];
+            open(edge.b, edge.length - fromOffset, -1);
+            startExit[edge.b] = edge.length;
+            open(edge.a, fromOffset, -1);
+            if (parentEdge[edge.a] < 0 && cost[edge.a] == fromOffset) startExit[edge.a] = 0;
+        }
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end());
+            auto [key, node] = heap.back();
+            heap.pop_back();
+            if (-key >= best.cost) break;
+            int nodeCost = cost[node];
+            if (-key != nodeCost + bound(node)) continue;   // superseded entry
+            if (goalNodeStamp[node] == currentStamp && nodeCost < best.cost) best = {nodeCost, node, -1, 0, 0};
+            for (uint32_t i = adjacencyStart[node]; i < adjacencyStart[node + 1]; i++) {
+                int id = adjacency[i];
+                const Edge& edge = edges[id];
+                if (goalEdgeStamp[id] == currentStamp) {
+                    if (node == edge.a && nodeCost + goalMin[id] < best.cost) {
+                        best = {nodeCost + goalMin[id], node, id, 0, goalMin[id]};
+                    }
+                    if (node == edge.b && nodeCost + edge.length - goalMax[id] < best.cost) {
+                        best = {nodeCost + edge.length - goalMax[id], node, id, edge.length, goalMax[id]};
+                    }
+                }
+                int next = node == edge.a ? edge.b : edge.a;
+                if (next != node) open(next, nodeCost + edge.length, id);
+            }
+        }
+        return best;
+    }
+
+    // Cells of an arrival's path after `from`, ending on the goal
+    void BuildPath(int from, const Arrival& arrival, std::vector<int>& path) {
+        path.clear();
+        int fromEdge = cellEdge[from];
+        int fromOffset = fromEdge >= 0 ? cellOffset[from] : 0;
+        if (arrival.node < 0) {
+            if (fromEdge >= 0) AppendWalk(fromEdge, fromOffset, arrival.offset, path);
+            return;
+        }
+        // Node chain back to the start, then replayed forwards
+        heap.clear();
+        int start = arrival.node;
+        while (parentEdge[start] >= 0) {
+            heap.push_back({parentEdge[start], start});
+            const Edge& edge = edges[parentEdge[start]];
+            start = edge.a == start ? edge.b : edge.a;
+        }
+        if (fromEdge >= 0) AppendWalk(fromEdge, fromOffset, startExit[start], path);
+        for (auto step = heap.rbegin(); step != heap.rend(); ++step) {
+            const Edge& edge = edges[step->first];
+            bool forward = edge.b == step->second;
+            AppendWalk(step->first, forward ? 0 : edge.length, forward ? edge.length : 0, path);
+        }
+        if (arrival.edge >= 0) AppendWalk(arrival.edge, arrival.entry, arrival.offset, path);
+    }
+
+public:
+    void Build(MazeGenerator& maze) {
+        MemoryScope scope(MemoryTag::NAV);
+        width = maze.GetWidth();
+        height = maze.GetHeight();
+        size_t cells = (size_t)width * height;
+        nodeCell.clear();
+        edges.clear();
+        corridorCells.clear();
+        cellNode.assign(cells, -1);
+        cellEdge.assign(cells, -1);
+        cellOffset.assign(cells, 0);
+
+        for (size_t i = 0; i < cells; i++) {
+            Cell* cell = maze.GetCell((int)i / height, (int)i % height);
+            int open = !cell->walls[0] + !cell->walls[1] + !cell->walls[2] + !cell->walls[3];
+            if (open != 2) AddNode((int)i);
+        }
+        for (int node = 0; node < (int)nodeCell.size(); node++) {
+            Cell* cell = maze.GetCell(nodeCell[node] / height, nodeCell[node] % height);
+            for (int side = 0; side < 4; side++) {
+                if (!cell->walls[side]) Walk(maze, node, side);
+            }
+        }
+        // A loop of corridor with no junction on it (only possible after
+        // walls are edited) gets a node of its own
+        for (size_t i = 0; i < cells; i++) {
+            if (cellNode[i] >= 0 || cellEdge[i] >= 0) continue;
+            int node = AddNode((int)i);
+            Cell* cell = maze.GetCell((int)i / height, (int)i % height);
+            for (int side = 0; side < 4; side++) {
+                if (!cell->walls[side]) Walk(maze, node, side);
+            }
+        }
+
+        size_t nodes = nodeCell.size();
+        adjacencyStart.assign(nodes + 1, 0);
+        for (const Edge& edge : edges) {
+            adjacencyStart[edge.a + 1]++;
+            if (edge.b != edge.a) adjacencyStart[edge.b + 1]++;
+        }
+        for (size_t i = 1; i <= nodes; i++) adjacencyStart[i] += adjacencyStart[i - 1];
+        adjacency.resize(adjacencyStart[nodes]);
+        std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (int id = 0; id < (int)edges.size(); id++) {
+            adjacency[fill[edges[id].a]++] = id;
+            if (edges[id].b != edges[id].a) adjacency[fill[edges[id].b]++] = id;
+        }
+
+        cost.assign(nodes, 0);
+        parentEdge.assign(nodes, -1);
+        startExit.assign(nodes, 0);
+        nodeStamp.assign(nodes, 0);
+        goalNodeStamp.assign(nodes, 0);
+        goalEdgeStamp.assign(edges.size(), 0);
+        goalMin.assign(edges.size(), 0);
+        goalMax.assign(edges.size(), 0);
+        // Each expansion pushes at most once per edge end, so searches never grow the heap
+        heap.clear();
+        heap.reserve(adjacency.size() + nodes);
+        currentStamp = 0;
+    }
+
+    bool IsBuiltFor(const MazeGenerator& maze) const {
+        return width == maze.GetWidth() && height == maze.GetHeight() && !cellNode.empty();
+    }
+    size_t GetNodeCount() const { return nodeCell.size(); }
+    size_t GetEdgeCount() const { return edges.size(); }
+
+    // Shortest path length between two cells, or -1 when unreachable; the
+    // cells after `from` go into `path` when given
+    int FindPath(int from, int to, std::vector<int>* path = nullptr) {
+        Arrival arrival = Search(from, &to, 1, to);
+        if (arrival.cost == INT32_MAX) return -1;
+        if (path) BuildPath(from, arrival, *path);
+        return arrival.cost;
+    }
+
+    // The same toward whichever of `goals` is nearest, stored in `goal`
+    int FindNearest(int from, const std::vector<int>& goals, int& goal, std::vector<int>* path = nullptr) {
+        goal = -1;
+        Arrival arrival = Search(from, goals.data(), goals.size(), -1);
+        if (arrival.cost == INT32_MAX) return -1;
+        std::vector<int> cells;
+        std::vector<int>& route = path ? *path : cells;
+        BuildPath(from, arrival, route);
+        goal = route.empty() ? from : route.back();
+        return arrival.cost;
+    }
+};
+
+// Breadth-first search over open walls. One instance serves many agents
+// in turn: its scratch arrays are sized to the maze once and reused. With
+// a CorridorGraph attached (and built for the maze's size) queries run on
+// the graph instead, and the limit applies to path length.
+class MazePathfinder {
+private:
+    LargeVector<uint32_t, MemoryTag::NAV> stamp;
+    LargeVector<uint32_t, MemoryTag::NAV> goalStamp;
+    LargeVector<int, MemoryTag::NAV> parent;
+    std::vector<int> queue;
+    uint32_t currentStamp = 0;
+    CorridorGraph* graph = nullptr;
+    std::vector<int> path;
+
+    void Prepare(const MazeGenerator& maze) {
+        MemoryScope scope(MemoryTag::NAV);
+        size_t cells = (size_t)maze.GetWidth() * maze.GetHeight();
+        if (stamp.size() != cells) {
+            stamp.assign(cells, 0);
+            goalStamp.assign(cells, 0);
+            parent.assign(cells, -1);
+            queue.reserve(cells);       // each cell is queued at most once
+            currentStamp = 0;
+        }
+        if (++currentStamp == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            std::fill(goalStamp.begin(), goalStamp.end(), 0);
+            currentStamp = 1;
+        }
+    }
+
+    // A path visits each cell at most once, so graph queries never grow it
+    void ReservePath(const MazeGenerator& maze) {
+        MemoryScope scope(MemoryTag::NAV);
+        path.reserve((size_t)maze.GetWidth() * maze.GetHeight());
+    }
+
+    // Searches out from `from` until it reaches a cell marked as a goal
+    int Search(MazeGenerator& maze, int from, int& goal, int maxCells) {
+        goal = -1;
+        if (goalStamp[from] == currentStamp) {
+            goal = from;
+            return from;
+        }
+        const int height = maze.GetHeight();
+        queue.clear();
+        queue.push_back(from);
+        stamp[from] = currentStamp;
+        for (size_t head = 0; head < queue.size() && (int)queue.size() < maxCells; head++) {
+            int current = queue[head];
+            Cell* cell = maze.GetCell(current / height, current % height);
+            for (int side = 0; side < 4; side++) {
+                if (cell->walls[side]) continue;
+                int next = (current / height + SIDE_DX[side]) * height + current % height + SIDE_DY[side];
+                if (stamp[next] == currentStamp) continue;
+                stamp[next] = currentStamp;
+                parent[next] = current;
+                if (goalStamp[next] == currentStamp) {
+                    goal = next;
+                    while (parent[next] != from) next = parent[next];
+                    return next;
+                }
+                queue.push_back(next);
+            }
+        }
+        return -1;
+    }
+
+public:
+    // The caller rebuilds the graph whenever the maze changes
+    void UseGraph(CorridorGraph* corridors) { graph = corridors; }
+
+    // The first cell on a shortest path from `from` to `to` (cell indices,
+    // x * height + y), `from` if already there, or -1 when farther than
+    // `maxCells` cells of search
+    int NextStep(MazeGenerator& maze, int from, int to, int maxCells = 4096) {
+        if (graph && graph->IsBuiltFor(maze)) {
+            ReservePath(maze);
+            int distance = graph->FindPath(from, to, &path);
+            if (distance < 0 || distance > maxCells) return -1;
+            return path.empty() ? from : path.front();
+        }
+        Prepare(maze);
+        goalStamp[to] = currentStamp;
+        int goal;
+        return Search(maze, from, goal, maxCells);
+    }
+
+    // The same toward whichever of `goals` is nearest by corridor distance,
+    // which is stored in `goal` (-1 when none is in reach)
+    int NextStepToNearest(MazeGenerator& maze, int from, const std::vector<int>& goals, int& goal,
+                          int maxCells = 4096) {
+        if (graph && graph->IsBuiltFor(maze)) {
+            ReservePath(maze);
+            int distance = graph->FindNearest(from, goals, goal, &path);
+            if (distance < 0 || distance > maxCells) {
+                goal = -1;
+                return -1;
+            }
+            return path.empty() ? from : path.front();
+        }
+        Prepare(maze);
+        for (int cell : goals) goalStamp[cell] = currentStamp;
+        return Search(maze, from, goal, maxCells);
+    }
+};
+
+// Hierarchical Pathfinding Settings
+const int HPA_CLUSTER_SIZE = 32;                // cells per cluster side, at most 60
+const size_t HPA_CACHE_STEPS = 1u << 24;        // cached leg steps before the cache starts over
+const uint16_t HPA_UNREACHABLE = 0xFFFF;
+
+// A path from HierarchicalPathfinder: the legs between the nodes it passes,
+// expanded into cells one leg at a time as the walker reaches them
+struct HierarchicalPath {
+    struct Leg {
+        int to;                 // cell the leg ends on
+        int cluster;            // cluster the leg stays inside, -1 for a step across a border
+        uint8_t a, b;           // its nodes at either end, NO_NODE at the start or goal
+        uint32_t revision;      // the cluster's revision when planned
+    };
+    std::vector<Leg> legs;
+    std::vector<int> cells;     // the expanded cells left of the current leg, last first
+    size_t nextLeg = 0;
+    int at = -1;                // the last cell handed out, the start before any
+    int length = 0;             // planned steps
+};
+
+// Hierarchical A* (HPA*) for mazes too large to search cell by cell. The
+// grid is cut into square clusters, and every open wall between two
+// clusters becomes a pair of nodes, one on each side. Distances between
+// the nodes of a cluster are precomputed by flooding inside it. A query
+// floods the start and goal clusters and searches the node graph, which
+// holds every way across a border, so paths are shortest. Each leg of the
+// result is expanded into cells only when the walker gets to it, and legs
+// between two nodes are cached. A wall edit rebuilds just the one or two
+// clusters it touches. The maze must outlive the pathfinder, and one
+// thread uses it at a time.
+class HierarchicalPathfinder {
+public:
+    static constexpr uint8_t NO_NODE = 0xFF;
+
+private:
+    static constexpr uint32_t START = 0xFFFFFFFFu;
+
+    struct Cluster {
+        std::vector<int> nodeCell;          // per node
+        std::vector<uint8_t> nodeSlot;      // per node: side * size + offset along the side
+        std::vector<uint8_t> slotNode;      // per slot: its node or NO_NODE
+        std::vector<uint16_t> linkStart;    // per node + 1: its first entry in links
+        std::vector<std::pair<uint8_t, uint16_t>> links;  // (node, distance) connected inside the cluster
+        uint32_t revision = 0;
+    };
+
+    MazeGenerator* maze = nullptr;
+    int size = HPA_CLUSTER_SIZE;
+    int width = 0;
+    int height = 0;
+    int clustersX = 0;
+    int clustersY = 0;
+    std::vector<Cluster> clusters;          // column-major like the cells
+    size_t nodeCount = 0;
+
+    // Flood scratch for one cluster at a time, indexed by local cell
+    std::vector<uint32_t> floodStamp;
+    std::vector<uint16_t> floodDistance;
+    std::vector<uint8_t> floodSide;         // side of its parent the cell was entered by
+    std::vector<int> floodQueue;
+    uint32_t floodCurrent = 0;
+    int floodX0 = 0;
+    int floodY0 = 0;
+    int floodCluster = -1;
+
+    // Search scratch: a cluster gets slots for its nodes when first touched
+    std::vector<uint32_t> clusterStamp;
+    std::vector<uint32_t> clusterBase;
+    std::vector<int> cost;
+    std::vector<uint32_t> parent;           // cluster << 8 | node, START at a start node
+    std::vector<std::pair<int, uint32_t>> heap;  // (-(cost + bound), cluster << 8 | node)
+    std::vector<uint16_t> startDistance;    // per node of the start cluster
+    std::vector<uint16_t> goalDistance;     // per node of the goal cluster
+    std::vector<uint32_t> chain;            // the found nodes, goal first
+    uint32_t searchStamp = 0;
+
+    // Expanded legs between nodes: sides stepped through, keyed by cluster,
+    // revision and nodes
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> legCache;
+    std::vector<uint8_t> legSteps;
+
+    int ClusterOf(int cell) const { return cell / height / size * clustersY + cell % height / size; }
+
+    void Bounds(int cluster, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = cluster / clustersY * size;
+        y0 = cluster % clustersY * size;
+        x1 = std::min(width, x0 + size);
+        y1 = std::min(height, y0 + size);
+    }
+
+    // The cluster across `side`, or -1 at the edge of the maze
+    int Neighbour(int cluster, int side) const {
+        int cx = cluster / clustersY + SIDE_DX[side];
+        int cy = cluster % clustersY + SIDE_DY[side];
+        if (cx < 0 || cx >= clustersX || cy < 0 || cy >= clustersY) return -1;
+        return cx * clustersY + cy;
+    }
+
+    // The cell at `offset` along a cluster's border on `side`
+    int BorderCell(int side, int offset, int x0, int y0, int x1, int y1) const {
+        switch (side) {
+            case 0: return (x0 + offset) * height + y1 - 1;
+            case 1: return (x1 - 1) * height + y0 + offset;
+            case 2: return (x0 + offset) * height + y0;
+            default: return x0 * height + y0 + offset;
+        }
+    }
+
+    // Breadth-first search from `from` without leaving its cluster
+    void Flood(int cluster, int from) {
+        if (++floodCurrent == 0) {
+            std::fill(floodStamp.begin(), floodStamp.end(), 0);
+            floodCurrent = 1;
+        }
+        int x0, y0, x1, y1;
+        Bounds(cluster, x0, y0, x1, y1);
+        floodX0 = x0;
+        floodY0 = y0;
+        floodCluster = cluster;
+        floodQueue.clear();
+        floodQueue.push_back(from);
+        int local = (from / height - x0) * size + from % height - y0;
+        floodStamp[local] = floodCurrent;
+        floodDistance[local] = 0;
+        for (size_t head = 0; head < floodQueue.size(); head++) {
+            int current = floodQueue[head];
+            int x = current / height;
+            int y = current % height;
+            uint16_t distance = floodDistance[(x - x0) * size + y - y0];
+            Cell* cell = maze->GetCell(x, y);
+            for (int side = 0; side < 4; side++) {
+                if (cell->walls[side]) continue;
+                int nx = x + SIDE_DX[side];
+                int ny = y + SIDE_DY[side];
+                if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1) continue;
+                int next = (nx - x0) * size + ny - y0;
+                if (floodStamp[next] == floodCurrent) continue;
+                floodStamp[next] = floodCurrent;
+                floodDistance[next] = distance + 1;
+                floodSide[next] = (uint8_t)side;
+                floodQueue.push_back(nx * height + ny);
+            }
+        }
+    }
+
+    // Steps from the last flood's start to `cell`, HPA_UNREACHABLE when not reached
+    uint16_t Flooded(int cell) const {
+        int local = (cell / height - floodX0) * size + cell % height - floodY0;
+        return floodStamp[local] == floodCurrent ? floodDistance[local] : HPA_UNREACHABLE;
+    }
+
+    void RebuildCluster(int index) {
+        Cluster& cluster = clusters[index];
+        nodeCount -= cluster.nodeCell.size();
+        cluster.nodeCell.clear();
+        cluster.nodeSlot.clear();
+        cluster.slotNode.assign((size_t)4 * size, NO_NODE);
+        int x0, y0, x1, y1;
+        Bounds(index, x0, y0, x1, y1);
+        for (int side = 0; side < 4; side++) {
+            if (Neighbour(index, side) < 0) continue;
+            int length = side % 2 == 0 ? x1 - x0 : y1 - y0;
+            for (int offset = 0; offset < length; offset++) {
+                int cell = BorderCell(side, offset, x0, y0, x1, y1);
+                if (maze->GetCell(cell / height, cell % height)->walls[side]) continue;
+                cluster.slotNode[side * size + offset] = (uint8_t)cluster.nodeCell.size();
+                cluster.nodeCell.push_back(cell);
+                cluster.nodeSlot.push_back((uint8_t)(side * size + offset));
+            }
+        }
+
+        size_t nodes = cluster.nodeCell.size();
+        nodeCount += nodes;
+        cluster.linkStart.assign(nodes + 1, 0);
+        cluster.links.clear();
+        for (size_t a = 0; a < nodes; a++) {
+            Flood(index, cluster.nodeCell[a]);
+            for (size_t b = 0; b < nodes; b++) {
+                uint16_t distance = Flooded(cluster.nodeCell[b]);
+                if (b != a && distance != HPA_UNREACHABLE) cluster.links.push_back({(uint8_t)b, distance});
+            }
+            cluster.linkStart[a + 1] = (uint16_t)cluster.links.size();
+        }
+        cluster.revision++;
+    }
+
+    int Slot(int cluster, int node) {
+        if (clusterStamp[cluster] != searchStamp) {
+            clusterStamp[cluster] = searchStamp;
+            clusterBase[cluster] = (uint32_t)cost.size();
+            cost.resize(cost.size() + clusters[cluster].nodeCell.size(), INT32_MAX);
+            parent.resize(cost.size());
+        }
+        return (int)clusterBase[cluster] + node;
+    }
+
+    // Expands a leg into its cells, last first, or fails when an edit has cut it
+    bool Refine(int from, const HierarchicalPath::Leg& leg, std::vector<int>& cells) {
+        cells.clear();
+        if (leg.cluster < 0) {
+            int dx = leg.to / height - from / height;
+            int dy = leg.to % height - from % height;
+            int side = dx > 0 ? 1 : dx < 0 ? 3 : dy > 0 ? 0 : 2;
+            if (maze->GetCell(from / height, from % height)->walls[side]) return false;
+            cells.push_back(leg.to);
+            return true;
+        }
+        const Cluster& cluster = clusters[leg.cluster];
+        bool cacheable = leg.a != NO_NODE && leg.b != NO_NODE && leg.revision == cluster.revision;
+        uint64_t key = (uint64_t)leg.cluster << 40 | (uint64_t)(leg.revision & 0xFFFFFF) << 16 | leg.a << 8 | leg.b;
+        if (cacheable) {
+            auto found = legCache.find(key);
+            if (found != legCache.end()) {
+                // The stored sides run forwards, so the cells are pushed from the far end
+                int cell = leg.to;
+                for (uint32_t i = found->second.first + found->second.second; i-- > found->second.first; ) {
+                    cells.push_back(cell);
+                    cell -= SIDE_DX[legSteps[i]] * height + SIDE_DY[legSteps[i]];
+                }
+                return true;
+            }
+        }
+        Flood(leg.cluster, from);
+        if (Flooded(leg.to) == HPA_UNREACHABLE) return false;
+        for (int cell = leg.to; cell != from; ) {
+            cells.push_back(cell);
+            uint8_t side = floodSide[(cell / height - floodX0) * size + cell % height - floodY0];
+            cell -= SIDE_DX[side] * height + SIDE_DY[side];
+        }
+        if (cacheable) {
+            if (legSteps.size() + cells.size() > HPA_CACHE_STEPS) {
+                legCache.clear();
+                legSteps.clear();
+            }
+            uint32_t first = (uint32_t)legSteps.size();
+            for (size_t i = cells.size(); i-- > 0; ) {
+                int previous = i + 1 < cells.size() ? cells[i + 1] : from;
+                int dx = cells[i] / height - previous / height;
+                int dy = cells[i] % height - previous % height;
+                legSteps.push_back((uint8_t)(dx > 0 ? 1 : dx < 0 ? 3 : dy > 0 ? 0 : 2));
+            }
+            legCache[key] = {first, (uint32_t)cells.size()};
+        }
+        return true;
+    }
+
+public:
+    void Build(MazeGenerator& mazeToSearch, int clusterSize = HPA_CLUSTER_SIZE) {
+        MemoryScope scope(MemoryTag::NAV);
+        maze = &mazeToSearch;
+        size = std::max(4, std::min(60, clusterSize));
+        width = maze->GetWidth();
+        height = maze->GetHeight();
+        clustersX = (width + size - 1) / size;
+        clustersY = (height + size - 1) / size;
+        clusters.assign((size_t)clustersX * clustersY, Cluster());
+        nodeCount = 0;
+        floodStamp.assign((size_t)size * size, 0);
+        floodDistance.assign((size_t)size * size, 0);
+        floodSide.assign((size_t)size * size, 0);
+        floodCurrent = 0;
+        clusterStamp.assign(clusters.size(), 0);
+        clusterBase.assign(clusters.size(), 0);
+        searchStamp = 0;
+        legCache.clear();
+        legSteps.clear();
+        for (int i = 0; i < (int)clusters.size(); i++) RebuildCluster(i);
+    }
+
+    bool IsBuiltFor(const MazeGenerator& other) const {
+        return maze == &other && width == other.GetWidth() && height == other.GetHeight();
+    }
+    size_t GetClusterCount() const { return clusters.size(); }
+    size_t GetNodeCount() const { return nodeCount; }
+    size_t GetCachedLegCount() const { return legCache.size(); }
+
+    // Call after the wall on `side` of (x, y) was opened or closed
+    void OnWallChanged(int x, int y, int side) {
+        MemoryScope scope(MemoryTag::NAV);
+        int cluster = ClusterOf(x * height + y);
+        RebuildCluster(cluster);
+        int nx = x + SIDE_DX[side];
+        int ny = y + SIDE_DY[side];
+        if (nx < 0 || nx >= width || ny < 0 || ny >= height) return;
+        int other = ClusterOf(nx * height + ny);
+        if (other != cluster) RebuildCluster(other);
+    }
+
+    // Plans a shortest path between two cells into `path` and returns its
+    // length, or -1 when unreachable. No cells are expanded yet.
+    int FindPath(int from, int to, HierarchicalPath& path) {
+        MemoryScope scope(MemoryTag::NAV);
+        path.legs.clear();
+        path.cells.clear();
+        path.nextLeg = 0;
+        path.at = from;
+        path.length = 0;
+        if (from == to) return 0;
+        const int startCluster = ClusterOf(from);
+        const int goalCluster = ClusterOf(to);
+        const Cluster& start = clusters[startCluster];
+        const Cluster& goal = clusters[goalCluster];
+
+        Flood(startCluster, from);
+        int best = INT32_MAX;
+        uint32_t bestNode = START;      // START: straight there inside the start cluster
+        if (startCluster == goalCluster && Flooded(to) != HPA_UNREACHABLE) best = Flooded(to);
+        startDistance.resize(start.nodeCell.size());
+        for (size_t i = 0; i < start.nodeCell.size(); i++) startDistance[i] = Flooded(start.nodeCell[i]);
+        Flood(goalCluster, to);
+        goalDistance.resize(goal.nodeCell.size());
+        for (size_t i = 0; i < goal.nodeCell.size(); i++) goalDistance[i] = Flooded(goal.nodeCell[i]);
+
+        if (++searchStamp == 0) {
+            std::fill(clusterStamp.begin(), clusterStamp.end(), 0);
+            searchStamp = 1;
+        }
+        cost.clear();
+        parent.clear();
+        heap.clear();
+        const int toX = to / height;
+        const int toY = to % height;
+        auto bound = [&](int cell) { return abs(cell / height - toX) + abs(cell % height - toY); };
+        auto open = [&](int cluster, int node, int nodeCost, uint32_t via) {
+            int slot = Slot(cluster, node);
+            if (cost[slot] <= nodeCost) return;
+            cost[slot] = nodeCost;
+            parent[slot] = via;
+            heap.push_back({-(nodeCost + bound(clusters[cluster].nodeCell[node])), (uint32_t)cluster << 8 | node});
+            std::push_heap(heap.begin(), heap.end());
+        };
+        for (size_t i = 0; i < start.nodeCell.size(); i++) {
+            if (startDistance[i] != HPA_UNREACHABLE) open(startCluster, (int)i, startDistance[i], START);
+        }
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end());
+            auto [key, id] = heap.back();
+            heap.pop_back();
+            if (-key >= best) break;
+            int clusterIndex = (int)(id >> 8);
+            int node = (int)(id & 0xFF);
+            const Cluster& cluster = clusters[clusterIndex];
+            int nodeCost = cost[Slot(clusterIndex, node)];
+            if (-key != nodeCost + bound(cluster.nodeCell[node])) continue;    // superseded entry
+            if (clusterIndex == goalCluster && goalDistance[node] != HPA_UNREACHABLE &&
+                nodeCost + goalDistance[node] < best) {
+                best = nodeCost + goalDistance[node];
+                bestNode = id;
+            }
+            for (uint32_t i = cluster.linkStart[node]; i < cluster.linkStart[node + 1]; i++) {
+                open(clusterIndex, cluster.links[i].first, nodeCost + cluster.links[i].second, id);
+            }
+            int side = cluster.nodeSlot[node] / size;
+            int neighbour = Neighbour(clusterIndex, side);
+            uint8_t across = clusters[neighbour].slotNode[(side + 2) % 4 * size + cluster.nodeSlot[node] % size];
+            if (across != NO_NODE) open(neighbour, across, nodeCost + 1, id);
+        }
+        if (best == INT32_MAX) return -1;
+
+        // Nodes from the goal back to the start, then legs between them forwards
+        path.length = best;
+        if (bestNode == START) {
+            path.legs.push_back({to, startCluster, NO_NODE, NO_NODE, start.revision});
+            return best;
+        }
+        chain.clear();
+        for (uint32_t id = bestNode; id != START; id = parent[Slot((int)(id >> 8), (int)(id & 0xFF))]) {
+            chain.push_back(id);
+        }
+        uint8_t previousNode = NO_NODE;
+        int previousCluster = startCluster;
+        for (size_t i = chain.size(); i-- > 0; ) {
+            int clusterIndex = (int)(chain[i] >> 8);
+            uint8_t node = (uint8_t)(chain[i] & 0xFF);
+            const Cluster& cluster = clusters[clusterIndex];
+            if (clusterIndex == previousCluster) {
+                path.legs.push_back({cluster.nodeCell[node], clusterIndex, previousNode, node, cluster.revision});
+            }
+            else {
+                path.legs.push_back({cluster.nodeCell[node], -1, NO_NODE, NO_NODE, 0});
+            }
+            previousNode = node;
+            previousCluster = clusterIndex;
+        }
+        path.legs.push_back({to, goalCluster, previousNode, NO_NODE, goal.revision});
+        return best;
+    }
+
+    // The next cell along `path`, expanding its next leg when the current
+    // one is used up. -1 at the goal, or when a wall edit has cut the path
+    // (plan again).
+    int Advance(HierarchicalPath& path) {
+        MemoryScope scope(MemoryTag::NAV);
+        while (path.cells.empty()) {
+            if (path.nextLeg >= path.legs.size()) return -1;
+            if (!Refine(path.at, path.legs[path.nextLeg], path.cells)) {
+                path.nextLeg = path.legs.size();
+                return -1;
+            }
+            path.nextLeg++;
+        }
+        path.at = path.cells.back();
+        path.cells.pop_back();
+        return path.at;
+    }
+};
+
+// Police AI: chase the bandit nearest by corridor distance along the maze
+// path and run it down once in its cell, or walk to random cells when none
+// is in view. Produces the same PlayerInput a human player sends, so it can
+// drive the local player, a networked bot or a headless match.
+class PoliceAutopilot {
+private:
+    std::vector<int> banditCells;
+    std::vector<int> plannedBanditCells;    // the search below is redone only when a cell changes
+    int plannedCell = -1;
+    int plannedNext = -1;
+    int plannedGoal = -1;
+    int wanderCell = -1;
+
+public:
+    static int CellIndex(const MazeGenerator& maze, Vector3 position) {
+        int x = std::max(0, std::min(maze.GetWidth() - 1, (int)((position.x + CELL_SIZE / 2) / CELL_SIZE)));
+        int y = std::max(0, std::min(maze.GetHeight() - 1, (int)((position.z + CELL_SIZE / 2) / CELL_SIZE)));
+        return x * maze.GetHeight() + y;
+    }
+
+    PlayerInput Think(MazeGenerator& maze, MazePathfinder& pathfinder, Vector3 position, NpcList bandits) {
+        const int height = maze.GetHeight();
+        int cell = CellIndex(maze, position);
+        PlayerInput input;
+
+        banditCells.clear();
+        for (const NPC& bandit : bandits) banditCells.push_back(CellIndex(maze, bandit.position));
+        if (cell != plannedCell || banditCells != plannedBanditCells) {
+            plannedCell = cell;
+            plannedBanditCells = banditCells;
+            plannedGoal = -1;
+            plannedNext = banditCells.empty() ? -1 : pathfinder.NextStepToNearest(maze, cell, banditCells, plannedGoal);
+        }
+        int goal = plannedGoal;
+        int next = plannedNext;
+        if (next < 0) {
+            if (wanderCell < 0 || wanderCell == cell) wanderCell = maze.Random(maze.GetWidth() * height);
+            next = pathfinder.NextStep(maze, cell, wanderCell);
+            if (next < 0) {
+                wanderCell = -1;
+                return input;
+            }
+        }
+
+        // Head for the next cell's centre, or straight at the bandit once in its cell
+        Vector3 aim = {(next / height) * CELL_SIZE, position.y, (next % height) * CELL_SIZE};
+        if (goal == cell) {
+            float best = 1e30f;
+            for (size_t i = 0; i < bandits.size(); i++) {
+                if (banditCells[i] != cell) continue;
+                float dx = bandits[i].position.x - position.x;
+                float dz = bandits[i].position.z - position.z;
+                if (dx * dx + dz * dz < best) {
+                    best = dx * dx + dz * dz;
+                    aim = bandits[i].position;
+                }
+            }
+        }
+        input.yaw = atan2f(aim.x - position.x, aim.z - position.z);
+        input.buttons = INPUT_FORWARD;
+        return input;
+    }
+};
+
+// Headless server until interrupted (or for `seconds`), printing stats periodically
+int RunServer(uint16_t port, uint32_t seed, int mazeSize, int npcCount, double seconds, bool interestManagement) {
+    GameServer server;
+    server.interestManagement = interestManagement;
+    if (!server.Start(port, seed, mazeSize, mazeSize, npcCount)) {
+        fprintf(stderr, "Could not start server on UDP port %d\n", port);
+        return 1;
+    }
+    printf("Server listening on UDP port %d (seed %u, %dx%d maze, %d NPCs)\n", server.GetPort(), seed,
+           mazeSize, mazeSize, npcCount);
+
+    std::atomic<bool> stop(false);
+    double elapsed = 0.0;
+    while (seconds <= 0.0 || elapsed < seconds) {
+        double slice = seconds > 0.0 ? std::min(10.0, seconds - elapsed) : 10.0;
+        server.Run(stop, slice);
+        elapsed += slice;
+        server.PrintStats(stdout);
+        fflush(stdout);
+    }
+    return 0;
+}
+
+// Loopback test: a server thread plus `botCount` clients on localhost, each
+// holding forward and turning at random through `link` conditions, with
+// client-side prediction. Reports server tick cost, bandwidth per client,
+// snapshot packet loss and the size of prediction corrections.
+int RunLoopbackTest(int botCount, double seconds, int mazeSize, int npcCount, bool interestManagement,
+                    const LinkConditions& link) {
+    GameServer server;
+    server.interestManagement = interestManagement;
+    if (!server.Start(0, 1234, mazeSize, mazeSize, npcCount, true)) {
+        fprintf(stderr, "Could not open loopback server socket\n");
+        return 1;
+    }
+    NetAddress address;
+    ParseAddress("127.0.0.1", address);
+    address.port = server.GetPort();
+
+    std::atomic<bool> stop(false);
+    std::thread serverThread([&] { server.Run(stop); });
+
+    std::vector<GameClient> bots(botCount);
+    std::vector<PlayerInput> inputs(botCount);
+    std::vector<PlayerPrediction> predictions(botCount);
+    MazeGenerator maze;         // the server's maze, shared by every bot's prediction
+    bool mazeReady = false;
+    const float tickSeconds = 1.0f / SERVER_TICK_RATE;
+    Rng rng;
+    rng.Seed(99);
+    for (int i = 0; i < botCount; i++) {
+        bots[i].SetLinkConditions(link, i);
+        if (!bots[i].Open(address)) {
+            fprintf(stderr, "Could not open client socket\n");
+            stop = true;
+            serverThread.join();
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / SERVER_TICK_RATE));
+    auto next = start;
+    double now = 0.0;
+    while (now < seconds) {
+        for (int i = 0; i < botCount; i++) {
+            GameClient& bot = bots[i];
+            bot.Update(now);
+            if (!bot.connected) continue;
+            if (!mazeReady) {
+                maze.Seed(bot.mazeSeed);
+                maze.Initialize(bot.mazeWidth, bot.mazeHeight);
+                maze.Generate();
+                mazeReady = true;
+            }
+            if (bot.selfTick != 0) {
+                predictions[i].Reconcile(maze, bot.selfPosition, bot.selfInput, bot.selfTick, tickSeconds);
+            }
+
+            PlayerInput& input = inputs[i];
+            input.sequence++;
+            if (rng.Range(30) == 0) input.yaw += (rng.Range(2) ? 1.0f : -1.0f) * PI / 2;
+            input.buttons = INPUT_FORWARD;
+            bot.SendInput(input);
+            predictions[i].Apply(maze, input, tickSeconds);
+        }
+        next += period;
+        std::this_thread::sleep_until(next);
+        now = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    for (auto& bot : bots) bot.Disconnect();
+    stop = true;
+    serverThread.join();
+
+    int connected = 0;
+    double snapshots = 0.0;
+    double ticksSpanned = 0.0;
+    for (const auto& bot : bots) {
+        if (bot.GetStats().snapshots == 0) continue;
+        connected++;
+        snapshots += bot.GetStats().snapshots;
+        ticksSpanned += bot.GetStats().lastTick - bot.GetStats().firstTick + 1;
+    }
+
+    std::vector<float> corrections;
+    uint64_t resets = 0;
+    for (const auto& prediction : predictions) {
+        const auto& predictionStats = prediction.GetStats();
+        corrections.insert(corrections.end(), predictionStats.corrections.begin(), predictionStats.corrections.end());
+        resets += predictionStats.resets;
+    }
+    std::sort(corrections.begin(), corrections.end());
+    size_t visible = corrections.end() - std::upper_bound(corrections.begin(), corrections.end(), 0.01f);
+
+    printf("Loopback test: %d bots for %.1f s, %dx%d maze, link %.0f ms RTT +/- %.0f ms, %.1f%% loss\n", botCount,
+           seconds, mazeSize, mazeSize, link.latencyMs, link.jitterMs, link.lossPercent);
+    server.PrintStats(stdout);
+    printf("  clients served: %d/%d, snapshots received %.0f of %.0f sent (%.2f%% lost)\n", connected, botCount,
+           snapshots, ticksSpanned, ticksSpanned > 0 ? std::max(0.0, 100.0 * (1.0 - snapshots / ticksSpanned)) : 0.0);
+    if (!corrections.empty()) {
+        printf("  prediction: %zu reconciles, correction p50 %.4f, p99 %.4f, max %.4f units; %.2f%% over 1 cm, %llu resets\n",
+               corrections.size(), corrections[corrections.size() / 2],
+               corrections[std::min(corrections.size() - 1, corrections.size() * 99 / 100)], corrections.back(),
+               100.0 * visible / corrections.size(), (unsigned long long)resets);
+    }
+    return 0;
+}
+
+// Load generator: `botCount` autopilot police playing on a server from one
+// process. Their sockets are watched with epoll, so a bot only does receive
+// work when a datagram is waiting; every bot sends its input each tick.
+// Reports snapshot loss, snapshot delay past the best case seen (server
+// tick lateness plus queueing) and the server's tick cost as it reports it.
+int RunBotLoad(int botCount, const char* serverAddress, double seconds, const LinkConditions& link) {
+#ifndef __linux__
+    (void)botCount; (void)serverAddress; (void)seconds; (void)link;
+    fprintf(stderr, "The bot load generator needs epoll (Linux)\n");
+    return 1;
+#else
+    NetAddress address;
+    if (!ParseAddress(serverAddress, address)) {
+        fprintf(stderr, "Bad server address %s\n", serverAddress);
+        return 1;
+    }
+
+    // One socket per bot: lift the descriptor limit as far as allowed
+    rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    int epoll = epoll_create1(0);
+    if (epoll < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+    std::vector<GameClient> bots(botCount);
+    std::vector<PoliceAutopilot> pilots(botCount);
+    std::vector<uint32_t> sequences(botCount, 0);
+    for (int i = 0; i < botCount; i++) {
+        bots[i].SetLinkConditions(link, i);
+        bots[i].recordArrivals = true;
+        if (!bots[i].Open(address)) {
+            fprintf(stderr, "Could not open socket for bot %d (descriptor limit?)\n", i);
+            botCount = i;
+            break;
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, bots[i].GetHandle(), &event);
+    }
+
+    MazeGenerator maze;         // the server's maze, shared by every autopilot
+    CorridorGraph corridors;
+    MazePathfinder pathfinder;
+    bool mazeReady = false;
+    std::vector<float> serverTickMs, workMs;
+    int lateTicks = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    auto seconds_since = [&](std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double>(t - start).count();
+    };
+    const double period = 1.0 / SERVER_TICK_RATE;
+    double nextTick = 0.0;
+    std::vector<epoll_event> events(4096);
+
+    for (;;) {
+        double now = seconds_since(std::chrono::steady_clock::now());
+        if (now >= seconds) break;
+        int timeoutMs = std::max(0, (int)((nextTick - now) * 1000.0));
+        int ready = epoll_wait(epoll, events.data(), (int)events.size(), timeoutMs);
+        now = seconds_since(std::chrono::steady_clock::now());
+        for (int e = 0; e < ready; e++) bots[events[e].data.u32].Update(now);
+        if (now < nextTick) continue;
+
+        auto workStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < botCount; i++) {
+            GameClient& bot = bots[i];
+            // Connection retries and simulated-link delivery run on the clock
+            if (!bot.connected || link.IsActive()) bot.Update(now);
+            if (!bot.connected) continue;
+            if (!mazeReady) {
+                maze.Seed(bot.mazeSeed);
+                maze.Initialize(bot.mazeWidth, bot.mazeHeight);
+                maze.Generate();
+                corridors.Build(maze);
+                pathfinder.UseGraph(&corridors);
+                mazeReady = true;
+            }
+            PlayerInput input;
+            if (bot.selfTick != 0) input = pilots[i].Think(maze, pathfinder, bot.selfPosition, bot.npcs);
+            input.sequence = ++sequences[i];
+            bot.SendInput(input);
+            if (i == 0 && bot.snapshotTick != 0) serverTickMs.push_back(bot.serverTickUs / 1000.0f);
+        }
+        workMs.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - workStart).count());
+
+        nextTick += period;
+        if (nextTick < now) {
+            lateTicks++;
+            nextTick = now + period;
+        }
+    }
+
+    for (auto& bot : bots) bot.Disconnect();
+    close(epoll);
+
+    // Per-bot delay past its best snapshot, pooled
+    int connected = 0;
+    double snapshots = 0.0, ticksSpanned = 0.0, bytesDown = 0.0, bytesUp = 0.0;
+    std::vector<float> delays;
+    for (const auto& bot : bots) {
+        const GameClient::Stats& stats = bot.GetStats();
+        bytesDown += stats.bytesReceived;
+        bytesUp += stats.bytesSent;
+        if (stats.snapshots == 0) continue;
+        connected++;
+        snapshots += stats.snapshots;
+        ticksSpanned += stats.lastTick - stats.firstTick + 1;
+        float best = *std::min_element(stats.arrivalOffsets.begin(), stats.arrivalOffsets.end());
+        for (float offset : stats.arrivalOffsets) delays.push_back((offset - best) * 1000.0f);
+    }
+    auto report = [](const char* label, std::vector<float>& values, const char* suffix) {
+        if (values.empty()) return;
+        std::sort(values.begin(), values.end());
+        printf("  %s: p50 %.2f ms, p99 %.2f ms, max %.2f ms%s\n", label, values[values.size() / 2],
+               values[std::min(values.size() - 1, values.size() * 99 / 100)], values.back(), suffix);
+    };
+
+    printf("Bot load: %d bots -> %s for %.1f s, link %.0f ms RTT +/- %.0f ms, %.1f%% loss\n", botCount,
+           serverAddress, seconds, link.latencyMs, link.jitterMs, link.lossPercent);
+    printf("  connected: %d/%d, snapshots received %.0f of %.0f sent (%.2f%% lost)\n", connected, botCount,
+           snapshots, ticksSpanned, ticksSpanned > 0 ? std::max(0.0, 100.0 * (1.0 - snapshots / ticksSpanned)) : 0.0);
+    report("snapshot delay past best", delays, "");
+    char budget[64];
+    snprintf(budget, sizeof(budget), " (budget %.2f ms)", 1000.0 / SERVER_TICK_RATE);
+    report("server tick cost", serverTickMs, budget);
+    printf("  traffic per bot: down %.1f KB/s, up %.1f KB/s\n", bytesDown / std::max(1, botCount) / seconds / 1024.0,
+           bytesUp / std::max(1, botCount) / seconds / 1024.0);
+    report("load generator tick work", workMs, "");
+    printf("  load generator late ticks: %d\n", lateTicks);
+    return connected > 0 ? 0 : 1;
+#endif
+}
+
+// Offline codec benchmark: simulates `npcCount` NPCs around a police player
+// standing mid-maze and encodes every tick both in full and as a delta
+// against the snapshot `ackDelay` ticks back (a 100 ms round trip), then
+// decodes both and checks them against the source.
+int RunSnapshotBenchmark(int npcCount, int mazeSize, int ticks) {
+    const int ackDelay = 6;
+    MazeGenerator maze;
+    maze.Seed(1234);
+    maze.Initialize(mazeSize, mazeSize);
+    maze.Generate();
+    SnapshotCodec codec;
+    codec.Configure(mazeSize, mazeSize);
+
+    std::vector<NPC> npcs(npcCount);
+    for (auto& npc : npcs) {
+        npc.position = maze.GetRandomSpawnPosition();
+        npc.target = maze.GetRandomSpawnPosition();
+        npc.color = (Color){(unsigned char)(maze.Random(200) + 55), (unsigned char)(maze.Random(200) + 55),
+                           (unsigned char)(maze.Random(200) + 55), 255};
+    }
+    Vector3 police = {mazeSize / 2 * CELL_SIZE, PLAYER_HEIGHT / 2, mazeSize / 2 * CELL_SIZE};
+
+    std::vector<std::vector<NetEntity>> history(ackDelay + 1);
+    std::vector<uint32_t> indices(npcCount), decodedIndices(npcCount);
+    for (int i = 0; i < npcCount; i++) indices[i] = i;
+    std::vector<NetEntity> decoded(npcCount);
+    std::vector<BitWriter> packets;
+    std::vector<size_t> packetFirsts;
+    uint64_t bytes[2] = {}, encoded[2] = {}, unchanged = 0, mismatches = 0;
+    double encodeSeconds[2] = {}, decodeSeconds[2] = {};
+    float maxError = 0.0f;
+    const float dt = 1.0f / SERVER_TICK_RATE;
+
+    for (int tick = 0; tick < ticks; tick++) {
+        for (auto& npc : npcs) {
+            npc.Think(maze, police, dt);
+            npc.Update(maze, dt);
+        }
+        std::vector<NetEntity>& current = history[tick % (ackDelay + 1)];
+        current.resize(npcCount);
+        for (int i = 0; i < npcCount; i++) current[i] = codec.Quantize(npcs[i]);
+        const std::vector<NetEntity>* baseline = tick >= ackDelay ? &history[(tick - ackDelay) % (ackDelay + 1)] : nullptr;
+
+        // Mode 0 is full, mode 1 delta
+        for (int mode = 0; mode < 2; mode++) {
+            const std::vector<NetEntity>* base = mode == 1 ? baseline : nullptr;
+            if (mode == 1 && !base) continue;
+            auto findBase = [&](uint32_t index) { return base ? &(*base)[index] : nullptr; };
+
+            auto start = std::chrono::steady_clock::now();
+            packets.clear();
+            packetFirsts.clear();
+            size_t index = 0;
+            do {
+                packetFirsts.push_back(index);
+                packets.emplace_back(NET_MAX_PACKET - 64);   // room for the packet header
+                index = codec.WriteRange(packets.back(), current, indices, index, findBase);
+            } while (index < current.size());
+            auto encodedAt = std::chrono::steady_clock::now();
+
+            for (size_t p = 0; p < packets.size(); p++) {
+                size_t end = p + 1 < packets.size() ? packetFirsts[p + 1] : current.size();
+                BitReader reader(packets[p].GetData(), packets[p].GetSize());
+                codec.ReadRange(reader, &decodedIndices[packetFirsts[p]], &decoded[packetFirsts[p]],
+                                end - packetFirsts[p], findBase);
+            }
+            auto decodedAt = std::chrono::steady_clock::now();
+
+            encodeSeconds[mode] += std::chrono::duration<double>(encodedAt - start).count();
+            decodeSeconds[mode] += std::chrono::duration<double>(decodedAt - encodedAt).count();
+            encoded[mode] += npcCount;
+            for (const auto& packet : packets) bytes[mode] += packet.GetSize();
+            for (int i = 0; i < npcCount; i++) {
+                if (decodedIndices[i] != (uint32_t)i || memcmp(&decoded[i], &current[i], sizeof(NetEntity)) != 0) mismatches++;
+            }
+            if (base) {
+                for (int i = 0; i < npcCount; i++) unchanged += memcmp(&(*base)[i], &current[i], sizeof(NetEntity)) == 0;
+            }
+        }
+        for (int i = 0; i < npcCount; i++) {
+            NPC replica;
+            codec.Dequantize(decoded[i], replica);
+            maxError = std::max(maxError, std::max(fabsf(replica.position.x - npcs[i].position.x),
+                                                   fabsf(replica.position.z - npcs[i].position.z)));
+        }
+    }
+
+    auto rate = [](uint64_t count, double seconds) { return seconds > 0.0 ? count / seconds / 1e6 : 0.0; };
+    printf("Snapshot codec: %d NPCs, %dx%d maze, %d ticks, deltas against the snapshot %d ticks back\n",
+           npcCount, mazeSize, mazeSize, ticks, ackDelay);
+    printf("  naive:     %6.2f B per NPC per tick\n", (double)NET_NAIVE_NPC_BYTES);
+    printf("  quantized: %6.2f B per NPC per tick (full)\n", (double)bytes[0] / std::max<uint64_t>(1, encoded[0]));
+    printf("  delta:     %6.2f B per NPC per tick (%.1f%% unchanged)\n",
+           (double)bytes[1] / std::max<uint64_t>(1, encoded[1]), 100.0 * unchanged / std::max<uint64_t>(1, encoded[1]));
+    printf("  encode: full %.1f M NPC/s, delta %.1f M NPC/s; decode: full %.1f M NPC/s, delta %.1f M NPC/s\n",
+           rate(encoded[0], encodeSeconds[0]), rate(encoded[1], encodeSeconds[1]),
+           rate(encoded[0], decodeSeconds[0]), rate(encoded[1], decodeSeconds[1]));
+    printf("  max position error %.4f (bound %.4f), %llu decode mismatches\n", maxError, codec.GetPrecision(),
+           (unsigned long long)mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// A fresh headless game in `world`: a maze from `seed`, the player,
+// `npcCount` NPCs and `policeCount` AI officers at random spawns. `maze` is
+// bound to the arena.
+void SetupWorld(WorldState& world, MazeGenerator& maze, uint32_t seed, int mazeSize, int npcCount,
+                int policeCount = 0) {
+    world.Allocate(npcCount, mazeSize, mazeSize, policeCount);
+    world.BindMaze(maze);
+    maze.Seed(seed);
+    maze.Initialize(mazeSize, mazeSize);
+    maze.Generate();
+    world.GetHeader().player.position = maze.GetRandomSpawnPosition();
+    for (NPC& npc : world.GetNpcList()) {
+        npc.position = maze.GetRandomSpawnPosition();
+        npc.target = maze.GetRandomSpawnPosition();
+        npc.color = WHITE;
+    }
+    for (int i = 0; i < policeCount; i++) world.GetPolice()[i].position = maze.GetRandomSpawnPosition();
+}
+
+// Save/restore cost of the world arena at `npcCount` NPCs, and a rollback
+// check: simulate a second ahead, restore, simulate again and compare
+int RunStateBenchmark(int npcCount, int mazeSize, int iterations) {
+    WorldState world;
+    MazeGenerator maze;
+    SetupWorld(world, maze, 1234, mazeSize, npcCount);
+    CrowdSeparation crowd;
+
+    std::vector<uint64_t> snapshot;
+    world.Save(snapshot);
+    std::vector<double> saveUs, restoreUs;
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::steady_clock::now();
+        world.Save(snapshot);
+        auto saved = std::chrono::steady_clock::now();
+        world.Restore(snapshot);
+        auto restored = std::chrono::steady_clock::now();
+        saveUs.push_back(std::chrono::duration<double, std::micro>(saved - start).count());
+        restoreUs.push_back(std::chrono::duration<double, std::micro>(restored - saved).count());
+    }
+    std::sort(saveUs.begin(), saveUs.end());
+    std::sort(restoreUs.begin(), restoreUs.end());
+
+    // Rollback: the same inputs from a restored state must give the same bytes
+    PlayerInput input;
+    input.buttons = INPUT_FORWARD;
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    world.Save(snapshot);
+    auto stepStart = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < SERVER_TICK_RATE; tick++) {
+        input.yaw = tick * 0.05f;
+        StepWorld(world, maze, input, dt, &crowd);
+    }
+    double stepMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stepStart).count() /
+                    SERVER_TICK_RATE;
+    std::vector<uint64_t> ahead;
+    world.Save(ahead);
+    world.Restore(snapshot);
+    for (int tick = 0; tick < SERVER_TICK_RATE; tick++) {
+        input.yaw = tick * 0.05f;
+        StepWorld(world, maze, input, dt, &crowd);
+    }
+    std::vector<uint64_t> replayed;
+    world.Save(replayed);
+    bool deterministic = memcmp(ahead.data(), replayed.data(), world.GetSize()) == 0;
+
+    double megabytes = world.GetSize() / (1024.0 * 1024.0);
+    printf("World state: %d NPCs, %dx%d maze, %.2f MB arena (%zu B per NPC, %zu B per cell)\n", npcCount, mazeSize,
+           mazeSize, megabytes, sizeof(NPC), sizeof(Cell));
+    printf("  save:    p50 %8.1f us, min %8.1f us (%.1f GB/s)\n", saveUs[saveUs.size() / 2], saveUs.front(),
+           world.GetSize() / (saveUs[saveUs.size() / 2] * 1e3));
+    printf("  restore: p50 %8.1f us, min %8.1f us (%.1f GB/s)\n", restoreUs[restoreUs.size() / 2],
+           restoreUs.front(), world.GetSize() / (restoreUs[restoreUs.size() / 2] * 1e3));
+    printf("  sim step %.2f ms; rollback of %d ticks replays %s\n", stepMs, SERVER_TICK_RATE,
+           deterministic ? "bit-identical" : "DIFFERENTLY");
+    return deterministic ? 0 : 1;
+}
+
+// Unattended play: the autopilot hunts bandits in a headless local world
+// for `seconds` of game time, stepped as fast as the CPU allows. Reports
+// how often it arrests one and how often it stalls against a wall, which
+// is what tuning the autopilot or the bandit AI looks at.
+int RunSoak(double seconds, uint32_t seed, int mazeSize, int npcCount) {
+    WorldState world;
+    MazeGenerator maze;
+    SetupWorld(world, maze, seed, mazeSize, npcCount);
+    WorldState::Header& header = world.GetHeader();
+
+    CorridorGraph corridors;
+    corridors.Build(maze);
+    MazePathfinder pathfinder;
+    pathfinder.UseGraph(&corridors);
+    PoliceAutopilot pilot;
+    CrowdSeparation crowd;
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    const uint64_t ticks = (uint64_t)(seconds * SERVER_TICK_RATE);
+    std::vector<double> captureIntervals;
+    uint64_t lastCaptureTick = 0;
+    uint64_t stalledTicks = 0;
+    double thinkSeconds = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        auto thinkStart = std::chrono::steady_clock::now();
+        PlayerInput input = pilot.Think(maze, pathfinder, header.player.position, world.GetNpcList());
+        thinkSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - thinkStart).count();
+        Vector3 before = header.player.position;
+        uint32_t captures = header.captures;
+        StepWorld(world, maze, input, dt, &crowd);
+        if (input.buttons && Vector3Distance(before, header.player.position) < header.player.speed * dt * 0.25f) {
+            stalledTicks++;
+        }
+        for (uint32_t i = captures; i < header.captures; i++) {
+            captureIntervals.push_back((double)(tick + 1 - lastCaptureTick) / SERVER_TICK_RATE);
+            lastCaptureTick = tick + 1;
+        }
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Soak: %.0f s of play, seed %u, %dx%d maze, %d bandits\n", seconds, seed, mazeSize, mazeSize, npcCount);
+    if (captureIntervals.empty()) {
+        printf("  no arrests\n");
+    }
+    else {
+        double total = 0.0;
+        for (double interval : captureIntervals) total += interval;
+        std::sort(captureIntervals.begin(), captureIntervals.end());
+        size_t count = captureIntervals.size();
+        printf("  %zu arrests, one every %.2f s (p50 %.2f s, p90 %.2f s, max %.2f s)\n", count, total / count,
+               captureIntervals[count / 2], captureIntervals[count * 9 / 10], captureIntervals.back());
+    }
+    printf("  stalled %.1f%% of ticks\n", 100.0 * stalledTicks / std::max<uint64_t>(1, ticks));
+    printf("  %.0fx real time (%.2f us per tick, %.2f us of it autopilot)\n",
+           seconds / std::max(wallSeconds, 1e-9), wallSeconds * 1e6 / std::max<uint64_t>(1, ticks),
+           thinkSeconds * 1e6 / std::max<uint64_t>(1, ticks));
+    return captureIntervals.empty() ? 1 : 0;
+}
+
+// Crowd separation cost at a quarter, half and all of `agentCount` NPCs,
+// with the maze scaled to keep the density of the full run on a
+// `mazeSize` maze (linear scaling shows as a flat cost per agent), and the
+// pairs left overlapping after two seconds with and without it. Agents
+// walking into each other settle just touching, so "deep" counts pairs
+// closer than one radius: one sphere through the other.
+int RunCrowdBenchmark(int agentCount, int mazeSize, uint32_t seed) {
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    const int ticks = 2 * SERVER_TICK_RATE;
+    printf("Crowd separation: %.2f agents per cell, %d ticks\n", (double)agentCount / (mazeSize * mazeSize), ticks);
+    printf("%8s %6s %10s %10s %12s %12s %12s %12s\n", "agents", "maze", "ms/tick", "ns/agent", "touch off",
+           "touch on", "deep off", "deep on");
+    for (int count : {agentCount / 4, agentCount / 2, agentCount}) {
+        int size = std::max(2, (int)lroundf(mazeSize * sqrtf((float)count / agentCount)));
+        uint64_t touching[2] = {};
+        uint64_t deep[2] = {};
+        double seconds = 0.0;
+        for (int separate = 0; separate < 2; separate++) {
+            WorldState world;
+            MazeGenerator maze;
+            SetupWorld(world, maze, seed, size, count);
+            CrowdSeparation crowd;
+            Vector3 police = maze.GetRandomSpawnPosition();
+            for (int tick = 0; tick < ticks; tick++) {
+                for (NPC& npc : world.GetNpcList()) {
+                    npc.Think(maze, police, dt);
+                    npc.Update(maze, dt);
+                }
+                if (!separate) continue;
+                auto start = std::chrono::steady_clock::now();
+                crowd.Apply(maze, world.GetNpcList());
+                seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            }
+            touching[separate] = crowd.CountOverlaps(maze, world.GetNpcList(), 2.0f * NPC_RADIUS);
+            deep[separate] = crowd.CountOverlaps(maze, world.GetNpcList(), NPC_RADIUS);
+        }
+        printf("%8d %6d %10.3f %10.1f %12llu %12llu %12llu %12llu\n", count, size, seconds * 1e3 / ticks,
+               seconds * 1e9 / ((double)ticks * std::max(1, count)), (unsigned long long)touching[0],
+               (unsigned long long)touching[1], (unsigned long long)deep[0], (unsigned long long)deep[1]);
+    }
+    return 0;
+}
+
+// A* over individual cells, the baseline CorridorGraph is measured against
+class GridAStar {
+private:
+    std::vector<int> cost;
+    std::vector<uint32_t> stamp;
+    std::vector<std::pair<int, int>> heap;  // (-(cost + bound), cell)
+    uint32_t currentStamp = 0;
+
+public:
+    // Shortest path length between two cells, or -1 when unreachable
+    int FindPath(MazeGenerator& maze, int from, int to) {
+        const int height = maze.GetHeight();
+        size_t cells = (size_t)maze.GetWidth() * height;
+        if (stamp.size() != cells) {
+            stamp.assign(cells, 0);
+            cost.assign(cells, 0);
+            currentStamp = 0;
+        }
+        if (++currentStamp == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            currentStamp = 1;
+        }
+        const int toX = to / height, toY = to % height;
+        auto bound = [&](int cell) { return abs(cell / height - toX) + abs(cell % height - toY); };
+        heap.clear();
+        heap.push_back({-bound(from), from});
+        stamp[from] = currentStamp;
+        cost[from] = 0;
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end());
+            auto [key, current] = heap.back();
+            heap.pop_back();
+            if (current == to) return cost[to];
+            if (-key != cost[current] + bound(current)) continue;   // superseded entry
+            Cell* cell = maze.GetCell(current / height, current % height);
+            for (int side = 0; side < 4; side++) {
+                if (cell->walls[side]) continue;
+                int next = current + SIDE_DX[side] * height + SIDE_DY[side];
+                if (stamp[next] == currentStamp && cost[next] <= cost[current] + 1) continue;
+                stamp[next] = currentStamp;
+                cost[next] = cost[current] + 1;
+                heap.push_back({-(cost[next] + bound(next)), next});
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+        return -1;
+    }
+};
+
+// Path queries on one large maze: grid A* against the corridor graph for
+// single targets, then the BFS pathfinder against the graph for the
+// nearest of several goals. Both sides must agree on every distance.
+int RunPathBenchmark(int mazeSize, uint32_t seed) {
+    const int queries = 1000;
+    const int goalCount = 16;
+    MazeGenerator maze;
+    maze.Seed(seed);
+    maze.Initialize(mazeSize, mazeSize);
+    maze.Generate();
+    const int cells = mazeSize * mazeSize;
+
+    CorridorGraph corridors;
+    auto start = std::chrono::steady_clock::now();
+    corridors.Build(maze);
+    double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("Path queries on a %dx%d maze: %d cells contract to %zu nodes and %zu edges (%.1f ms)\n", mazeSize,
+           mazeSize, cells, corridors.GetNodeCount(), corridors.GetEdgeCount(), buildMs);
+
+    Rng rng;
+    rng.Seed(seed);
+    std::vector<std::pair<int, int>> pairs(queries);
+    for (auto& pair : pairs) {
+        pair.first = rng.Range(cells);
+        pair.second = rng.Range(cells);
+    }
+    std::vector<std::vector<int>> goalSets(queries, std::vector<int>(goalCount));
+    for (auto& goals : goalSets) {
+        for (int& goal : goals) goal = rng.Range(cells);
+    }
+
+    auto time = [](auto&& run) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    };
+    int mismatches = 0;
+    long long totalLength = 0;
+
+    GridAStar grid;
+    std::vector<int> gridLengths(queries), graphLengths(queries);
+    double gridUs = time([&] {
+        for (int i = 0; i < queries; i++) gridLengths[i] = grid.FindPath(maze, pairs[i].first, pairs[i].second);
+    });
+    std::vector<int> path;
+    double graphUs = time([&] {
+        for (int i = 0; i < queries; i++) graphLengths[i] = corridors.FindPath(pairs[i].first, pairs[i].second, &path);
+    });
+    for (int i = 0; i < queries; i++) {
+        mismatches += gridLengths[i] != graphLengths[i];
+        totalLength += gridLengths[i];
+    }
+    printf("%-28s %12s %12s %9s\n", "query", "grid us", "graph us", "speedup");
+    printf("%-28s %12.2f %12.2f %8.1fx   (mean length %lld)\n", "A* to one cell", gridUs / queries,
+           graphUs / queries, gridUs / std::max(graphUs, 1e-3), totalLength / queries);
+
+    // Ties may pick different goals, so the distances to them are compared
+    MazePathfinder bfs;
+    std::vector<int> bfsGoals(queries), graphGoals(queries);
+    double bfsUs = time([&] {
+        for (int i = 0; i < queries; i++) bfs.NextStepToNearest(maze, pairs[i].first, goalSets[i], bfsGoals[i], cells);
+    });
+    double nearestUs = time([&] {
+        for (int i = 0; i < queries; i++) {
+            corridors.FindNearest(pairs[i].first, goalSets[i], graphGoals[i], &path);
+        }
+    });
+    for (int i = 0; i < queries; i++) {
+        int bfsLength = grid.FindPath(maze, pairs[i].first, bfsGoals[i]);
+        int graphLength = grid.FindPath(maze, pairs[i].first, graphGoals[i]);
+        mismatches += bfsLength != graphLength;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "nearest of %d (BFS vs graph)", goalCount);
+    printf("%-28s %12.2f %12.2f %8.1fx\n", label, bfsUs / queries, nearestUs / queries,
+           bfsUs / std::max(nearestUs, 1e-3));
+    printf("Distance mismatches: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Very large mazes: builds the corridor graph and the cluster hierarchy,
+// compares their single queries, then walks agents along hierarchical
+// paths cell by cell while walls are opened and closed under them.
+int RunHierarchyBenchmark(int mazeSize, uint32_t seed) {
+    const int queries = 100;
+    const int walkerCount = 1000;
+    const int ticks = 2000;
+    auto elapsedMs = [](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+    MazeGenerator maze;
+    maze.Seed(seed);
+    auto start = std::chrono::steady_clock::now();
+    maze.Initialize(mazeSize, mazeSize);
+    maze.Generate();
+    double generateMs = elapsedMs(start);
+    const int height = mazeSize;
+    const int cells = mazeSize * mazeSize;
+
+    CorridorGraph corridors;
+    start = std::chrono::steady_clock::now();
+    corridors.Build(maze);
+    double corridorMs = elapsedMs(start);
+    HierarchicalPathfinder hierarchy;
+    start = std::chrono::steady_clock::now();
+    hierarchy.Build(maze);
+    double hierarchyMs = elapsedMs(start);
+    printf("Hierarchical paths on a %dx%d maze (generated in %.0f ms)\n", mazeSize, mazeSize, generateMs);
+    printf("  corridor graph: %zu nodes, built in %.0f ms\n", corridors.GetNodeCount(), corridorMs);
+    printf("  hierarchy: %zu clusters of %d cells, %zu nodes, built in %.0f ms\n", hierarchy.GetClusterCount(),
+           HPA_CLUSTER_SIZE * HPA_CLUSTER_SIZE, hierarchy.GetNodeCount(), hierarchyMs);
+
+    auto canStep = [&](int from, int to) {
+        int dx = to / height - from / height;
+        int dy = to % height - from % height;
+        int side = dx > 0 ? 1 : dx < 0 ? 3 : dy > 0 ? 0 : 2;
+        return abs(dx) + abs(dy) == 1 && !maze.GetCell(from / height, from % height)->walls[side];
+    };
+    // Steps along a path, checking each crosses an open wall; -1 if one does not
+    auto walk = [&](int from, HierarchicalPath& path) {
+        int steps = 0;
+        for (int next = hierarchy.Advance(path); next >= 0; next = hierarchy.Advance(path)) {
+            if (!canStep(from, next)) return -1;
+            from = next;
+            steps++;
+        }
+        return steps;
+    };
+    Rng rng;
+    rng.Seed(seed);
+    HierarchicalPath path;
+    int mismatches = 0;
+    auto compare = [&](const char* label) {
+        double corridorUs = 0.0, planUs = 0.0, expandUs = 0.0;
+        long long totalLength = 0;
+        for (int i = 0; i < queries; i++) {
+            int from = rng.Range(cells), to = rng.Range(cells);
+            auto begin = std::chrono::steady_clock::now();
+            int exact = corridors.FindPath(from, to);
+            corridorUs += elapsedMs(begin) * 1e3;
+            begin = std::chrono::steady_clock::now();
+            int planned = hierarchy.FindPath(from, to, path);
+            planUs += elapsedMs(begin) * 1e3;
+            begin = std::chrono::steady_clock::now();
+            int walked = planned >= 0 ? walk(from, path) : -1;
+            expandUs += elapsedMs(begin) * 1e3;
+            mismatches += planned != exact || walked != planned || (walked >= 0 && path.at != to && from != to);
+            totalLength += std::max(exact, 0);
+        }
+        printf("  %s: mean length %lld, corridor A* %.0f us, hierarchy plan %.0f us + expand %.0f us\n", label,
+               totalLength / queries, corridorUs / queries, planUs / queries, expandUs / queries);
+    };
+    compare("queries");
+
+    // Walkers take one cell per tick toward random goals. Every tick a door
+    // opens through a random wall or an earlier door closes, so the maze
+    // stays connected, and walkers whose path a closing door cuts plan again.
+    struct Walker {
+        int cell;
+        int goal;
+        HierarchicalPath path;
+    };
+    std::vector<Walker> walkers(walkerCount);
+    int plans = 0;
+    for (Walker& walker : walkers) {
+        walker.cell = rng.Range(cells);
+        walker.goal = rng.Range(cells);
+        hierarchy.FindPath(walker.cell, walker.goal, walker.path);
+        plans++;
+    }
+    struct Door {
+        int x, y, side;
+    };
+    std::vector<Door> doors;
+    double stepMs = 0.0, editMs = 0.0;
+    int edits = 0, cutPaths = 0;
+    for (int tick = 0; tick < ticks; tick++) {
+        Door door = {rng.Range(mazeSize), rng.Range(mazeSize), rng.Range(4)};
+        bool close = !doors.empty() && rng.Range(2) == 0;
+        if (close) {
+            size_t pick = (size_t)rng.Range((int)doors.size());
+            door = doors[pick];
+            doors[pick] = doors.back();
+            doors.pop_back();
+        }
+        if (close || maze.GetCell(door.x, door.y)->walls[door.side]) {
+            if (maze.SetWall(door.x, door.y, door.side, close)) {
+                if (!close) doors.push_back(door);
+                auto begin = std::chrono::steady_clock::now();
+                hierarchy.OnWallChanged(door.x, door.y, door.side);
+                editMs += elapsedMs(begin);
+                edits++;
+            }
+        }
+        auto begin = std::chrono::steady_clock::now();
+        for (Walker& walker : walkers) {
+            int next = hierarchy.Advance(walker.path);
+            if (next < 0 || !canStep(walker.cell, next)) {
+                if (walker.cell == walker.goal) walker.goal = rng.Range(cells);
+                else cutPaths++;
+                hierarchy.FindPath(walker.cell, walker.goal, walker.path);
+                plans++;
+                next = hierarchy.Advance(walker.path);
+                if (next < 0) continue;
+            }
+            walker.cell = next;
+        }
+        stepMs += elapsedMs(begin);
+    }
+    printf("  %d walkers, %d ticks: %.0f ns per step, %d plans (%d cut by edits)\n", walkerCount, ticks,
+           stepMs * 1e6 / ((double)walkerCount * ticks), plans, cutPaths);
+    printf("  %d wall edits: %.0f us each to rebuild the clusters touched, %zu legs cached\n", edits,
+           editMs * 1e3 / std::max(1, edits), hierarchy.GetCachedLegCount());
+
+    start = std::chrono::steady_clock::now();
+    corridors.Build(maze);
+    printf("  corridor graph rebuilt after the edits in %.0f ms\n", elapsedMs(start));
+    compare("queries after edits");
+    printf("Distance mismatches: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// The same large maze stored column-major and tiled, timed through the
+// access patterns the game uses: generation, whole-grid scans, chunked
+// scans as the mesher builds, breadth-first search, cluster floods and
+// wall collision
+int RunLayoutBenchmark(int mazeSize, uint32_t seed) {
+    MazeGenerator mazes[2];
+    const char* names[2] = {"column-major", "tiled"};
+    double results[7][2] = {};
+    const char* tests[7] = {"generate", "scan x then y", "scan y then x", "16x16 chunks", "breadth-first search",
+                            "cluster floods", "collision"};
+    uint64_t checks[2] = {};
+    const int cells = mazeSize * mazeSize;
+    auto time = [](auto&& run) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+    for (int layout = 0; layout < 2; layout++) {
+        MazeGenerator& maze = mazes[layout];
+        maze.SetLayout(layout ? CellLayout::TILED : CellLayout::COLUMN_MAJOR);
+        maze.Seed(seed);
+        uint64_t& check = checks[layout];
+        results[0][layout] = time([&] {
+            maze.Initialize(mazeSize, mazeSize);
+            maze.Generate();
+        });
+        results[1][layout] = time([&] {
+            for (int x = 0; x < mazeSize; x++) {
+                for (int y = 0; y < mazeSize; y++) check += maze.GetCell(x, y)->walls[0];
+            }
+        });
+        results[2][layout] = time([&] {
+            for (int y = 0; y < mazeSize; y++) {
+                for (int x = 0; x < mazeSize; x++) check += maze.GetCell(x, y)->walls[1];
+            }
+        });
+        results[3][layout] = time([&] {
+            for (int chunkX = 0; chunkX < mazeSize; chunkX += MESH_CHUNK_CELLS) {
+                for (int chunkY = 0; chunkY < mazeSize; chunkY += MESH_CHUNK_CELLS) {
+                    for (int x = chunkX; x < std::min(chunkX + MESH_CHUNK_CELLS, mazeSize); x++) {
+                        for (int y = chunkY; y < std::min(chunkY + MESH_CHUNK_CELLS, mazeSize); y++) {
+                            check += maze.GetCell(x, y)->walls[2];
+                        }
+                    }
+                }
+            }
+        });
+        MazePathfinder pathfinder;
+        results[4][layout] = time([&] {
+            int centre = mazeSize / 2 * mazeSize + mazeSize / 2;
+            for (int corner : {0, mazeSize - 1, cells - mazeSize, cells - 1}) {
+                check += pathfinder.NextStep(maze, centre, corner, cells);
+            }
+        });
+        HierarchicalPathfinder hierarchy;
+        results[5][layout] = time([&] { hierarchy.Build(maze); });
+        check += hierarchy.GetNodeCount();
+        // Agents taking small random steps, as players and bandits do
+        Rng rng;
+        rng.Seed(seed);
+        results[6][layout] = time([&] {
+            for (int agent = 0; agent < 10000; agent++) {
+                Vector3 position = {rng.Range(mazeSize) * CELL_SIZE, 0.0f, rng.Range(mazeSize) * CELL_SIZE};
+                for (int step = 0; step < 200; step++) {
+                    float angle = rng.Range(628) / 100.0f;
+                    Vector3 next = {position.x + cosf(angle) * 0.3f, 0.0f, position.z + sinf(angle) * 0.3f};
+                    if (!maze.CheckWallCollision(next)) position = next;
+                    else check++;
+                }
+            }
+        });
+    }
+
+    // Same seed, so both layouts must hold the same maze
+    int mismatches = checks[0] != checks[1];
+    for (int x = 0; x < mazeSize; x++) {
+        for (int y = 0; y < mazeSize; y++) {
+            mismatches += memcmp(mazes[0].GetCell(x, y)->walls, mazes[1].GetCell(x, y)->walls, 4) != 0;
+        }
+    }
+    printf("Cell layouts on a %dx%d maze (%zu-byte cells)\n", mazeSize, mazeSize, sizeof(Cell));
+    printf("%-22s %14s %14s %9s\n", "ms", names[0], names[1], "speedup");
+    for (int i = 0; i < 7; i++) {
+        printf("%-22s %14.1f %14.1f %8.2fx\n", tests[i], results[i][0], results[i][1],
+               results[i][0] / std::max(results[i][1], 1e-3));
+    }
+    printf("Mismatched cells: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Resident memory of this process on huge pages, in KB (-1 when unknown):
+// transparent ones (AnonHugePages) plus hugetlbfs ones (Private_Hugetlb),
+// which AnonHugePages does not count
+static long ReadHugePagesKb() {
+    long kb = -1;
+#ifdef __linux__
+    if (FILE* file = fopen("/proc/self/smaps_rollup", "r")) {
+        char line[256];
+        long value;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "AnonHugePages: %ld kB", &value) == 1 ||
+                sscanf(line, "Private_Hugetlb: %ld kB", &value) == 1) {
+                kb = std::max(kb, 0L) + value;
+            }
+        }
+        fclose(file);
+    }
+#endif
+    return kb;
+}
+
+// A huge maze and its pathfinder grids mapped on small pages, then on
+// large pages (--huge-pages picks transparent or explicit), timed on the
+// random access the game makes: cell lookups, wall collision and
+// breadth-first search. Run it under `perf stat -e dTLB-loads,dTLB-load-misses`
+// to see the TLB misses behind the difference
+int RunHugePageBenchmark(int mazeSize, uint32_t seed) {
+    const LargePages largeMode = largePagePolicy.mode == LargePages::OFF ? LargePages::TRANSPARENT
+                                                                          : largePagePolicy.mode;
+    const char* names[2] = {"small pages", "transparent huge"};
+    const char* tests[4] = {"generate", "random cell lookups", "collision", "breadth-first search"};
+    double results[4][2] = {};
+    long hugeKb[2] = {};
+    uint64_t checks[2] = {};
+    const int cells = mazeSize * mazeSize;
+    auto time = [](auto&& run) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+    const LargePages savedMode = largePagePolicy.mode;
+    const uint64_t hugetlbBefore = hugetlbBlocks.load(std::memory_order_relaxed);
+    for (int run = 0; run < 2; run++) {
+        largePagePolicy.mode = run ? largeMode : LargePages::OFF;
+        long hugeBefore = ReadHugePagesKb();
+        MazeGenerator maze;
+        maze.Seed(seed);
+        uint64_t& check = checks[run];
+        results[0][run] = time([&] {
+            maze.Initialize(mazeSize, mazeSize);
+            maze.Generate();
+        });
+        // AI reads of random cells, as sight and interest checks make
+        Rng rng;
+        rng.Seed(seed);
+        results[1][run] = time([&] {
+            for (int i = 0; i < 20000000; i++) {
+                check += maze.GetCell(rng.Range(mazeSize), rng.Range(mazeSize))->walls[i & 3];
+            }
+        });
+        results[2][run] = time([&] {
+            for (int agent = 0; agent < 100000; agent++) {
+                Vector3 position = {rng.Range(mazeSize) * CELL_SIZE, 0.0f, rng.Range(mazeSize) * CELL_SIZE};
+                for (int step = 0; step < 20; step++) {
+                    float angle = rng.Range(628) / 100.0f;
+                    Vector3 next = {position.x + cosf(angle) * 0.3f, 0.0f, position.z + sinf(angle) * 0.3f};
+                    if (!maze.CheckWallCollision(next)) position = next;
+                    else check++;
+                }
+            }
+        });
+        MazePathfinder pathfinder;
+        results[3][run] = time([&] {
+            int centre = mazeSize / 2 * mazeSize + mazeSize / 2;
+            for (int corner : {0, mazeSize - 1, cells - mazeSize, cells - 1}) {
+                check += pathfinder.NextStep(maze, centre, corner, cells);
+            }
+        });
+        long hugeAfter = ReadHugePagesKb();
+        hugeKb[run] = hugeBefore >= 0 && hugeAfter >= 0 ? hugeAfter - hugeBefore : -1;
+    }
+    largePagePolicy.mode = savedMode;
+    // EXPLICIT falls back to transparent pages when none are reserved, so
+    // the column says what the grids actually got
+    bool explicitMapped = hugetlbBlocks.load(std::memory_order_relaxed) != hugetlbBefore;
+    if (explicitMapped) names[1] = "explicit huge";
+
+    double gridMb = (double)cells * (sizeof(Cell) + 3 * sizeof(uint32_t)) / (1 << 20);
+    printf("Page sizes on a %dx%d maze (%.0f MB of cell and search grids), pages first touched by %s\n", mazeSize,
+           mazeSize, gridMb, largePagePolicy.spread ? "the worker pool" : "the allocating thread");
+    printf("%-22s %16s %16s %9s\n", "ms", names[0], names[1], "speedup");
+    for (int i = 0; i < 4; i++) {
+        printf("%-22s %16.1f %16.1f %8.2fx\n", tests[i], results[i][0], results[i][1],
+               results[i][0] / std::max(results[i][1], 1e-3));
+    }
+    if (hugeKb[1] >= 0) printf("%-22s %16ld %16ld\n", "huge page MB", hugeKb[0] / 1024, hugeKb[1] / 1024);
+    if (largeMode == LargePages::EXPLICIT && !explicitMapped) {
+        printf("No hugetlbfs pages could be mapped (vm.nr_hugepages), so explicit fell back to transparent\n");
+    }
+    int mismatches = checks[0] != checks[1];
+    printf("Mismatched results: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// The default-size maze through FixedMaze and through the runtime
+// MazeGenerator: generation, breadth-first steps and wall collision, with
+// every answer compared
+int RunFixedMazeBenchmark(uint32_t seed) {
+    using SmallMaze = FixedMaze<MAZE_WIDTH, MAZE_HEIGHT>;
+    const int mazes = 20000;
+    const int probes = 4000000;
+    auto time = [](auto&& run) {
+        auto begin = std::chrono::steady_clock::now();
+        run();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    };
+    MazeGenerator runtime;
+    SmallMaze fixed;
+    int mismatches = 0;
+
+    double runtimeGenerate = time([&] {
+        for (int i = 0; i < mazes; i++) {
+            runtime.Seed(seed + i);
+            runtime.Initialize(MAZE_WIDTH, MAZE_HEIGHT);
+            runtime.Generate();
+        }
+    });
+    Rng rng;
+    double fixedGenerate = time([&] {
+        for (int i = 0; i < mazes; i++) {
+            rng.Seed(seed + i);
+            fixed.Generate(rng);
+        }
+    });
+    // Both end on the last seed's maze
+    for (int x = 0; x < MAZE_WIDTH; x++) {
+        for (int y = 0; y < MAZE_HEIGHT; y++) {
+            for (int side = 0; side < 4; side++) {
+                mismatches += fixed.IsWall(x, y, side) != runtime.GetCell(x, y)->walls[side];
+            }
+        }
+    }
+
+    // Every cell to every cell
+    const int cells = MAZE_WIDTH * MAZE_HEIGHT;
+    std::vector<int> runtimeSteps((size_t)cells * cells), fixedSteps((size_t)cells * cells);
+    MazePathfinder pathfinder;
+    double runtimeSearch = time([&] {
+        for (int from = 0; from < cells; from++) {
+            for (int to = 0; to < cells; to++) {
+                runtimeSteps[(size_t)from * cells + to] = pathfinder.NextStep(runtime, from, to);
+            }
+        }
+    });
+    double fixedSearch = time([&] {
+        for (int from = 0; from < cells; from++) {
+            int fromIndex = SmallMaze::Index(from / MAZE_HEIGHT, from % MAZE_HEIGHT);
+            for (int to = 0; to < cells; to++) {
+                int step = fixed.NextStep(fromIndex, SmallMaze::Index(to / MAZE_HEIGHT, to % MAZE_HEIGHT));
+                fixedSteps[(size_t)from * cells + to] =
+                    (step >> SmallMaze::SHIFT) * MAZE_HEIGHT + (step & (SmallMaze::STRIDE - 1));
+            }
+        }
+    });
+    for (size_t i = 0; i < runtimeSteps.size(); i++) mismatches += runtimeSteps[i] != fixedSteps[i];
+
+    std::vector<Vector3> points(4096);
+    rng.Seed(seed);
+    for (Vector3& point : points) {
+        point = {rng.Range(MAZE_WIDTH * 1000) / 1000.0f - 0.5f, 0.0f, rng.Range(MAZE_HEIGHT * 1000) / 1000.0f - 0.5f};
+    }
+    int runtimeHits = 0, fixedHits = 0;
+    double runtimeCollision = time([&] {
+        for (int i = 0; i < probes; i++) runtimeHits += runtime.CheckWallCollision(points[i & 4095]);
+    });
+    double fixedCollision = time([&] {
+        for (int i = 0; i < probes; i++) fixedHits += fixed.CheckWallCollision(points[i & 4095]);
+    });
+    mismatches += runtimeHits != fixedHits;
+
+    printf("%dx%d maze, runtime MazeGenerator against FixedMaze<%d, %d> (stride %d)\n", MAZE_WIDTH, MAZE_HEIGHT,
+           MAZE_WIDTH, MAZE_HEIGHT, SmallMaze::STRIDE);
+    printf("%-24s %12s %12s %9s\n", "ns per", "runtime", "fixed", "speedup");
+    auto row = [](const char* label, double runtimeNs, double fixedNs, double count) {
+        printf("%-24s %12.1f %12.1f %8.1fx\n", label, runtimeNs / count, fixedNs / count,
+               runtimeNs / std::max(fixedNs, 1.0));
+    };
+    row("generated maze", runtimeGenerate, fixedGenerate, mazes);
+    row("breadth-first step", runtimeSearch, fixedSearch, (double)cells * cells);
+    row("collision test", runtimeCollision, fixedCollision, probes);
+    printf("Mismatches: %d\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+// Balance settings one batch of Monte Carlo matches is played with
+struct MatchConfig {
+    float playerSpeed = PLAYER_SPEED;
+    float banditSpeed = 2.0f;
+    float fleeDistance = 3.0f;
+    float chaseDistance = 5.0f;
+};
+
+struct MatchResult {
+    uint32_t arrests = 0;
+    float firstArrest = -1.0f;      // seconds into the match, -1 when there was none
+    std::vector<float> intervals;   // seconds between arrests (the first counted from the start)
+};
+
+// One headless match of the autopilot against `npcCount` bandits. `world`,
+// `maze`, `corridors`, `pathfinder` and `crowd` are scratch reused across a
+// thread's matches.
+MatchResult PlayMatch(const MatchConfig& config, uint32_t seed, int mazeSize, int npcCount, double seconds,
+                      WorldState& world, MazeGenerator& maze, CorridorGraph& corridors,
+                      MazePathfinder& pathfinder, CrowdSeparation& crowd) {
+    SetupWorld(world, maze, seed, mazeSize, npcCount);
+    corridors.Build(maze);
+    pathfinder.UseGraph(&corridors);
+    WorldState::Header& header = world.GetHeader();
+    header.player.speed = config.playerSpeed;
+    for (NPC& npc : world.GetNpcList()) {
+        npc.speed = config.banditSpeed;
+        npc.fleeDistance = config.fleeDistance;
+        npc.chaseDistance = config.chaseDistance;
+    }
+
+    MatchResult result;
+    PoliceAutopilot pilot;
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    const uint64_t ticks = (uint64_t)(seconds * SERVER_TICK_RATE);
+    uint64_t lastArrestTick = 0;
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        uint32_t arrests = header.captures;
+        StepWorld(world, maze, pilot.Think(maze, pathfinder, header.player.position, world.GetNpcList()), dt,
+                  &crowd);
+        for (uint32_t i = arrests; i < header.captures; i++) {
+            result.intervals.push_back((float)(tick + 1 - lastArrestTick) / SERVER_TICK_RATE);
+            lastArrestTick = tick + 1;
+        }
+    }
+    result.arrests = header.captures;
+    if (result.arrests > 0) result.firstArrest = result.intervals.front();
+    maze.Unbind();
+    return result;
+}
+
+// Balance sweep: `matchCount` matches for every configuration, spread over
+// `threadCount` threads. Match i uses seed `seed + i` in every configuration,
+// so configurations are compared on the same mazes and spawns. Prints the
+// arrest-time distribution of each configuration and writes it to CSV.
+int RunMonteCarlo(const std::vector<MatchConfig>& configs, int matchCount, int threadCount, double seconds,
+                  uint32_t seed, int mazeSize, int npcCount, const char* csvPath) {
+    size_t jobCount = configs.size() * (size_t)matchCount;
+    std::vector<MatchResult> results(jobCount);
+    std::atomic<size_t> nextJob(0);
+    threadCount = std::max(1, threadCount);
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back([&] {
+            WorldState world;
+            MazeGenerator maze;
+            CorridorGraph corridors;
+            MazePathfinder pathfinder;
+            CrowdSeparation crowd;
+            for (size_t job = nextJob++; job < jobCount; job = nextJob++) {
+                const MatchConfig& config = configs[job / matchCount];
+                results[job] = PlayMatch(config, seed + (uint32_t)(job % matchCount), mazeSize, npcCount, seconds,
+                                         world, maze, corridors, pathfinder, crowd);
+            }
+        });
+#ifdef __linux__
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i % cores, &cpus);
+        pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpus), &cpus);
+#else
+        (void)cores;
+#endif
+    }
+    for (std::thread& thread : threads) thread.join();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    FILE* csv = fopen(csvPath, "w");
+    if (csv) {
+        fprintf(csv, "player_speed,bandit_speed,flee_distance,chase_distance,matches,arrests_per_min,no_arrest_pct,"
+                     "first_p50_s,first_p90_s,interval_mean_s,interval_p10_s,interval_p50_s,interval_p90_s,"
+                     "interval_max_s\n");
+    }
+    printf("Monte Carlo: %zu configurations x %d matches of %.0f s, %dx%d maze, %d bandits, %d threads\n",
+           configs.size(), matchCount, seconds, mazeSize, mazeSize, npcCount, threadCount);
+    printf("%6s %6s %6s %6s %9s %8s %9s %9s %9s %9s %9s\n", "police", "bandit", "flee", "chase", "arrest/m",
+           "none %", "first p50", "first p90", "gap mean", "gap p50", "gap p90");
+
+    // Quantiles of sorted samples; censored matches (no arrest) are left out
+    auto quantile = [](const std::vector<float>& sorted, double fraction) {
+        if (sorted.empty()) return -1.0f;
+        return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+    };
+    for (size_t c = 0; c < configs.size(); c++) {
+        const MatchConfig& config = configs[c];
+        std::vector<float> firsts, intervals;
+        uint64_t arrests = 0;
+        int empty = 0;
+        double intervalTotal = 0.0;
+        for (int m = 0; m < matchCount; m++) {
+            const MatchResult& result = results[c * matchCount + m];
+            arrests += result.arrests;
+            if (result.arrests == 0) empty++;
+            else firsts.push_back(result.firstArrest);
+            for (float interval : result.intervals) intervalTotal += interval;
+            intervals.insert(intervals.end(), result.intervals.begin(), result.intervals.end());
+        }
+        std::sort(firsts.begin(), firsts.end());
+        std::sort(intervals.begin(), intervals.end());
+        double perMinute = arrests * 60.0 / (seconds * matchCount);
+        double emptyPercent = 100.0 * empty / matchCount;
+        double intervalMean = intervals.empty() ? -1.0 : intervalTotal / intervals.size();
+        printf("%6.2f %6.2f %6.2f %6.2f %9.2f %8.1f %9.2f %9.2f %9.2f %9.2f %9.2f\n", config.playerSpeed,
+               config.banditSpeed, config.fleeDistance, config.chaseDistance, perMinute, emptyPercent,
+               quantile(firsts, 0.5), quantile(firsts, 0.9), intervalMean, quantile(intervals, 0.5),
+               quantile(intervals, 0.9));
+        if (csv) {
+            fprintf(csv, "%.3f,%.3f,%.3f,%.3f,%d,%.4f,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", config.playerSpeed,
+                    config.banditSpeed, config.fleeDistance, config.chaseDistance, matchCount, perMinute,
+                    emptyPercent, quantile(firsts, 0.5), quantile(firsts, 0.9), intervalMean,
+                    quantile(intervals, 0.1), quantile(intervals, 0.5), quantile(intervals, 0.9),
+                    intervals.empty() ? -1.0f : intervals.back());
+        }
+    }
+    if (csv) {
+        fclose(csv);
+        printf("Distributions written to %s\n", csvPath);
+    }
+    double simulated = seconds * jobCount;
+    printf("%.0f simulated seconds in %.2f s wall (%.2f M simulated seconds per wall minute)\n", simulated,
+           wallSeconds, simulated / std::max(wallSeconds, 1e-9) * 60.0 / 1e6);
+    return 0;
+}
+
+// Generated mazes shared read-only between rooms with the same seed and
+// size. Entries are weak, so a maze is freed with the last room using it.
+struct SharedMaze {
+    uint64_t seed;
+    int width;
+    int height;
+    std::vector<Cell> cells;    // column-major, as MazeGenerator stores them
+};
+
+class MazeCache {
+private:
+    std::mutex mutex;
+    std::map<std::tuple<uint64_t, int, int>, std::weak_ptr<const SharedMaze>> entries;
+    int hits = 0;
+    int misses = 0;
+
+public:
+    std::shared_ptr<const SharedMaze> Get(uint64_t seed, int width, int height) {
+        const auto key = std::make_tuple(seed, width, height);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (std::shared_ptr<const SharedMaze> cached = entries[key].lock()) {
+                hits++;
+                return cached;
+            }
+        }
+
+        // Generated outside the lock, so rooms on other mazes don't wait
+        // behind it; if another thread built the same maze meanwhile, its
+        // copy wins and this one is dropped
+        MazeGenerator generator;
+        generator.Seed(seed);
+        generator.Initialize(width, height);
+        generator.Generate();
+        auto maze = std::make_shared<SharedMaze>();
+        maze->seed = seed;
+        maze->width = width;
+        maze->height = height;
+        maze->cells.reserve((size_t)width * height);
+        for (int x = 0; x < width; x++) {
+            for (int y = 0; y < height; y++) maze->cells.push_back(*generator.GetCell(x, y));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::weak_ptr<const SharedMaze>& entry = entries[key];
+        if (std::shared_ptr<const SharedMaze> cached = entry.lock()) {
+            hits++;
+            return cached;
+        }
+        misses++;
+        entry = maze;
+        return maze;
+    }
+
+    int GetHits() const { return hits; }
+    int GetMisses() const { return misses; }
+};
+
+// One independent match for the room scheduler: its own RNG, NPCs and
+// police over a shared maze. The police are in-process bots walking at
+// random through ApplyPlayerInput; NPCs react to the nearest one, as on
+// GameServer.
+class GameRoom {
+public:
+    double lastTickUs = 0.0;
+    double totalTickUs = 0.0;
+    uint64_t ticks = 0;
+    uint64_t overBudget = 0;
+
+private:
+    std::shared_ptr<const SharedMaze> shared;
+    MazeGenerator maze;
+    std::vector<NPC> npcs;
+    std::vector<Player> police;
+    std::vector<PlayerInput> inputs;
+    CrowdSeparation crowd;
+
+public:
+    void Start(std::shared_ptr<const SharedMaze> sharedMaze, uint64_t seed, int npcCount, int policeCount) {
+        shared = std::move(sharedMaze);
+        maze.BindShared(shared->cells.data(), shared->width, shared->height);
+        maze.Seed(seed);
+
+        npcs.resize(npcCount);
+        for (auto& npc : npcs) {
+            npc.position = maze.GetRandomSpawnPosition();
+            npc.target = maze.GetRandomSpawnPosition();
+            npc.color = WHITE;
+        }
+        police.resize(policeCount);
+        inputs.resize(policeCount);
+        for (auto& officer : police) officer.position = maze.GetRandomSpawnPosition();
+        for (auto& input : inputs) input.buttons = INPUT_FORWARD;
+    }
+
+    void Tick(float dt, double budgetUs) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < police.size(); i++) {
+            if (maze.Random(30) == 0) inputs[i].yaw += (maze.Random(2) ? 1.0f : -1.0f) * PI / 2;
+            ApplyPlayerInput(police[i], maze, inputs[i], dt);
+        }
+        for (auto& npc : npcs) {
+            Vector3 nearest = {1e9f, 0.0f, 1e9f};
+            float best = 1e30f;
+            for (const auto& officer : police) {
+                float dx = officer.position.x - npc.position.x;
+                float dz = officer.position.z - npc.position.z;
+                if (dx * dx + dz * dz < best) {
+                    best = dx * dx + dz * dz;
+                    nearest = officer.position;
+                }
+            }
+            npc.Think(maze, nearest, dt);
+            npc.Update(maze, dt);
+        }
+        crowd.Apply(maze, npcs);
+
+        lastTickUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        totalTickUs += lastTickUs;
+        ticks++;
+        if (lastTickUs > budgetUs) overBudget++;
+    }
+};
+
+// Runs many rooms in lockstep ticks on a fixed set of worker threads (pinned
+// to cores on Linux). Each room has a home worker; every tick a worker
+// queues its rooms most expensive first (by last tick cost), runs them from
+// the front, and when it runs dry steals from the back of other workers'
+// queues, so cheap rooms move to balance the load. A room's tick budget is
+// its fair share of the workers' tick period.
+class RoomScheduler {
+public:
+    struct Stats {
+        uint64_t roomTicks = 0;
+        uint64_t steals = 0;
+    };
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<int> queue;
+        std::thread thread;
+        uint64_t steals = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<GameRoom>> rooms;
+    std::vector<int> home;
+
+    std::mutex mutex;
+    std::condition_variable startSignal;
+    std::condition_variable doneSignal;
+    uint64_t generation = 0;
+    int remaining = 0;
+    bool quit = false;
+    float tickSeconds = 0.0f;
+    double budgetUs = 0.0;
+
+    bool Take(int self, int& room) {
+        {
+            Worker& own = *workers[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.queue.empty()) {
+                room = own.queue.front();
+                own.queue.pop_front();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < workers.size(); offset++) {
+            Worker& victim = *workers[(self + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.queue.empty()) {
+                room = victim.queue.back();
+                victim.queue.pop_back();
+                workers[self]->steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(int self) {
+        uint64_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startSignal.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            int room;
+            int done = 0;
+            while (Take(self, room)) {
+                rooms[room]->Tick(tickSeconds, budgetUs);
+                done++;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            remaining -= done;
+            if (remaining == 0) doneSignal.notify_one();
+        }
+    }
+
+public:
+    explicit RoomScheduler(int threadCount) {
+        int cores = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < std::max(1, threadCount); i++) {
+            workers.push_back(std::make_unique<Worker>());
+            workers.back()->thread = std::thread([this, i] { WorkerLoop(i); });
+#ifdef __linux__
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % cores, &cpus);
+            pthread_setaffinity_np(workers.back()->thread.native_handle(), sizeof(cpus), &cpus);
+#else
+            (void)cores;
+#endif
+        }
+    }
+
+    ~RoomScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        startSignal.notify_all();
+        for (auto& worker : workers) worker->thread.join();
+    }
+
+    void AddRoom(std::unique_ptr<GameRoom> room) {
+        home.push_back((int)(rooms.size() % workers.size()));
+        rooms.push_back(std::move(room));
+    }
+
+    // Ticks every room once and returns when all are done. The count, tick
+    // parameters and generation are set under `mutex` before any room is
+    // queued: a worker still draining the previous generation may steal a new
+    // room, and its `remaining -= done` must land on the new count.
+    void Tick(float dt) {
+        std::vector<int> order(rooms.size());
+        for (size_t i = 0; i < rooms.size(); i++) order[i] = (int)i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](int a, int b) { return rooms[a]->lastTickUs > rooms[b]->lastTickUs; });
+
+        std::unique_lock<std::mutex> lock(mutex);
+        tickSeconds = dt;
+        budgetUs = dt * 1e6 * workers.size() / std::max<size_t>(1, rooms.size());
+        remaining = (int)rooms.size();
+        for (int room : order) {
+            std::lock_guard<std::mutex> queueLock(workers[home[room]]->mutex);
+            workers[home[room]]->queue.push_back(room);
+        }
+        generation++;
+        startSignal.notify_all();
+        doneSignal.wait(lock, [&] { return remaining == 0; });
+    }
+
+    int GetThreadCount() const { return (int)workers.size(); }
+    double GetBudgetUs() const { return budgetUs; }
+    const std::vector<std::unique_ptr<GameRoom>>& GetRooms() const { return rooms; }
+
+    uint64_t GetSteals() const {
+        uint64_t steals = 0;
+        for (const auto& worker : workers) steals += worker->steals;
+        return steals;
+    }
+};
+
+// Hosted-mode benchmark: `roomCount` independent rooms over `seedCount`
+// distinct mazes, ticked at 60 Hz for `seconds`. Reports tick wall time
+// against the period, per-room cost against its budget and the rooms per
+// core that cost implies.
+int RunRoomBenchmark(int roomCount, int threadCount, int seedCount, int mazeSize, int npcCount, int policeCount,
+                     double seconds) {
+    MazeCache cache;
+    RoomScheduler scheduler(threadCount);
+    int cores = (int)std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < roomCount; i++) {
+        auto room = std::make_unique<GameRoom>();
+        room->Start(cache.Get((uint64_t)(i % seedCount), mazeSize, mazeSize), (uint64_t)i + 1, npcCount, policeCount);
+        scheduler.AddRoom(std::move(room));
+    }
+
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(dt));
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    std::vector<float> wallMs;
+    int late = 0;
+    while (std::chrono::duration<double>(next - start).count() < seconds) {
+        auto tickStart = std::chrono::steady_clock::now();
+        scheduler.Tick(dt);
+        auto tickEnd = std::chrono::steady_clock::now();
+        wallMs.push_back(std::chrono::duration<float, std::milli>(tickEnd - tickStart).count());
+        next += period;
+        if (tickEnd > next) {
+            late++;
+            next = tickEnd;     // drop the backlog instead of bursting
+        }
+        std::this_thread::sleep_until(next);
+    }
+
+    double roomUs = 0.0;
+    uint64_t roomTicks = 0, overBudget = 0, worstOver = 0;
+    std::vector<float> roomMeans;
+    for (const auto& room : scheduler.GetRooms()) {
+        roomUs += room->totalTickUs;
+        roomTicks += room->ticks;
+        overBudget += room->overBudget;
+        worstOver = std::max(worstOver, room->overBudget);
+        roomMeans.push_back((float)(room->totalTickUs / std::max<uint64_t>(1, room->ticks)));
+    }
+    std::sort(wallMs.begin(), wallMs.end());
+    std::sort(roomMeans.begin(), roomMeans.end());
+    double meanRoomUs = roomUs / std::max<uint64_t>(1, roomTicks);
+    double periodUs = 1e6 / SERVER_TICK_RATE;
+    size_t sharedBytes = (size_t)cache.GetMisses() * mazeSize * mazeSize * sizeof(Cell);
+
+    printf("Rooms: %d rooms on %d threads for %.1f s, %dx%d maze, %d NPCs and %d police each\n", roomCount,
+           scheduler.GetThreadCount(), seconds, mazeSize, mazeSize, npcCount, policeCount);
+    printf("  maze cache: %d mazes shared by %d rooms (%.1f KB instead of %.1f KB)\n", cache.GetMisses(), roomCount,
+           sharedBytes / 1024.0, (double)roomCount * mazeSize * mazeSize * sizeof(Cell) / 1024.0);
+    printf("  tick wall: p50 %.2f ms, p99 %.2f ms, max %.2f ms (period %.2f ms), %d late of %zu\n",
+           wallMs[wallMs.size() / 2], wallMs[std::min(wallMs.size() - 1, wallMs.size() * 99 / 100)], wallMs.back(),
+           periodUs / 1000.0, late, wallMs.size());
+    printf("  room tick: mean %.1f us (rooms %.1f-%.1f us), budget %.1f us, %.2f%% of room ticks over (worst room %llu)\n",
+           meanRoomUs, roomMeans.front(), roomMeans.back(), scheduler.GetBudgetUs(),
+           100.0 * overBudget / std::max<uint64_t>(1, roomTicks), (unsigned long long)worstOver);
+    printf("  work stealing: %llu steals (%.1f%% of room ticks)\n", (unsigned long long)scheduler.GetSteals(),
+           100.0 * scheduler.GetSteals() / std::max<uint64_t>(1, roomTicks));
+    // Capacity from wall time includes scheduling; the room cost alone is the ceiling
+    double meanWallUs = 0.0;
+    for (float ms : wallMs) meanWallUs += ms * 1000.0 / wallMs.size();
+    printf("  capacity: about %.0f rooms per core at %d Hz (room cost alone: %.0f)\n",
+           roomCount * periodUs / (std::max(1e-3, meanWallUs) * std::min(scheduler.GetThreadCount(), cores)),
+           SERVER_TICK_RATE, periodUs / std::max(1e-3, meanRoomUs));
+    return 0;
+}
+
+// Fixed pool of worker threads. ParallelFor splits [0, count) into chunks of
+// `grain` items; the calling thread takes chunks too and returns once all are done.
+class WorkerPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int, int)>* job = nullptr;
+    int jobCount = 0;
+    int jobGrain = 1;
+    std::atomic<int> nextIndex{0};
+    int busyWorkers = 0;
+    unsigned generation = 0;
+    bool quit = false;
+
+    void RunChunks() {
+        while (true) {
+            int begin = nextIndex.fetch_add(jobGrain);
+            if (begin >= jobCount) break;
+            (*job)(begin, std::min(begin + jobGrain, jobCount));
+        }
+    }
+
+    void WorkerLoop() {
+        unsigned seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            RunChunks();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) finished.notify_one();
+        }
+    }
+
+public:
+    explicit WorkerPool(int threadCount = 0) {
+        if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+        if (threadCount <= 0) threadCount = 1;
+        // The calling thread is one of the workers
+        for (int i = 1; i < threadCount; i++) {
+            workers.emplace_back(&WorkerPool::WorkerLoop, this);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int GetThreadCount() const { return (int)workers.size() + 1; }
+
+    template <typename Fn>
+    void ParallelFor(int count, int grain, const Fn& fn) {
+        if (count <= 0) return;
+        if (grain < 1) grain = 1;
+        if (workers.empty() || count <= grain) {
+            fn(0, count);
+            return;
+        }
+        // Wrapping a reference keeps std::function from copying the closure to the heap
+        const std::function<void(int, int)> call(std::cref(fn));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &call;
+            jobCount = count;
+            jobGrain = grain;
+            nextIndex.store(0);
+            busyWorkers = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        RunChunks();
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+};
+
+// First touch of a large block from a pool's threads. Each large page
+// goes to whichever worker claims it next, so the block is interleaved
+// across the NUMA nodes the pool runs on instead of sitting on the
+// allocating thread's node. Callers on other threads wait their turn
+void SpreadPages(WorkerPool& pool, unsigned char* memory, size_t bytes) {
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    pool.ParallelFor((int)(bytes / LARGE_PAGE_BYTES), 1, [&](int begin, int end) {
+        for (size_t page = (size_t)begin; page < (size_t)end; page++) {
+            // One write per small page; a huge page faults in whole on the first
+            for (size_t offset = 0; offset < LARGE_PAGE_BYTES; offset += 4096) {
+                memory[page * LARGE_PAGE_BYTES + offset] = 0;
+            }
+        }
+    });
+}
+
+// Squad Settings
+const int SQUAD_SIGHT = 12;                             // cells an officer sees down a straight corridor
+const uint32_t SQUAD_MEMORY_TICKS = 10 * SERVER_TICK_RATE;  // how long a sighting is worth chasing
+const int SQUAD_PLAN_TICKS = 6;                         // ticks between re-partitioning the maze
+const int SQUAD_GATE_SEARCH = 64;                       // cells searched beyond a bandit for its way out
+
+// A squad of police: the player plus the AI officers of the world arena,
+// hunting with shared knowledge. Every tick each bandit is pushed onto its
+// cell's list. Then every officer scans the straight corridors it can see
+// and records in the sighting map when each cell last held a bandit. Both
+// passes run on the worker pool and only write atomics, so they take no
+// lock.
+//
+// Every SQUAD_PLAN_TICKS one BFS seeded from all officers at once splits
+// the maze into regions by corridor distance. Each officer chases the
+// nearest remembered sighting in its own region. An officer with none
+// patrols to its region's far end. The maze is a spanning tree, so a
+// chased bandit can only run into the subtree beyond it, and it can only
+// leave the chaser's region through a gate into a neighbouring region. A
+// patrolling neighbour is sent to hold that gate. The BFS tree also gives
+// every officer its route, so a plan costs O(cells) however big the squad.
+class PoliceSquad {
+public:
+    enum Mode : uint8_t { PATROL, CHASE, INTERCEPT };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t plans = 0;
+        uint64_t orders[3] = {};        // per Mode, summed over plans
+        double observeSeconds = 0.0;
+        double planSeconds = 0.0;
+    };
+
+private:
+    struct Order {
+        Mode mode = PATROL;
+        int target = -1;                // cell
+    };
+
+    WorkerPool* pool;
+    std::vector<std::atomic<uint32_t>> lastSeen;    // per cell: stamp of the last sighting, 0 if none or cleared
+    std::vector<std::atomic<uint64_t>> cellHead;    // per cell: list stamp << 32 | first bandit + 1
+    std::vector<uint32_t> banditNext;               // per bandit: next bandit + 1 in its cell's list
+    uint32_t listStamp = 0;
+    std::vector<int> owner;                         // per cell: the member whose region it is
+    std::vector<int> parent;                        // per cell: next cell toward its owner
+    std::vector<int> queue;
+    std::vector<int> gateQueue;
+    std::vector<Order> orders;                      // per member, 0 being the player
+    std::vector<int> patrolTargets;                 // per member: patrol target kept across plans
+    bool planned = false;
+    MazePathfinder pathfinder;                      // for members that left their route
+    CrowdSeparation crowd;
+    Stats stats;
+
+    static uint32_t Stamp(uint64_t tick) { return (uint32_t)tick + 1; }
+
+    void Prepare(WorldState& world) {
+        MemoryScope scope(MemoryTag::NAV);
+        size_t cells = world.GetCellCount();
+        if (owner.size() != cells) {
+            lastSeen = std::vector<std::atomic<uint32_t>>(cells);
+            cellHead = std::vector<std::atomic<uint64_t>>(cells);
+            for (size_t i = 0; i < cells; i++) {
+                lastSeen[i].store(0, std::memory_order_relaxed);
+                cellHead[i].store(0, std::memory_order_relaxed);
+            }
+            owner.assign(cells, -1);
+            parent.assign(cells, -1);
+            // Each cell is queued at most once, so planning never grows these
+            queue.reserve(cells);
+            gateQueue.reserve(cells);
+            planned = false;
+        }
+        banditNext.resize(world.GetHeader().npcCount);
+        orders.resize(GetMemberCount(world));
+        patrolTargets.resize(orders.size(), -1);
+    }
+
+    template <typename Fn>
+    void ForEach(int count, int grain, const Fn& fn) {
+        if (pool) pool->ParallelFor(count, grain, fn);
+        else fn(0, count);
+    }
+
+    // First bandit + 1 on a cell's list, or 0 when the list is stale
+    uint32_t FirstBandit(int cell) const {
+        uint64_t head = cellHead[cell].load(std::memory_order_relaxed);
+        return (uint32_t)(head >> 32) == listStamp ? (uint32_t)head : 0;
+    }
+
+    // Past a chased bandit in `cell`, the nearest cell of another region
+    // (the way out), or -1 when the bandit is cornered in this one
+    int FindGate(MazeGenerator& maze, int member, int cell) {
+        const int height = maze.GetHeight();
+        gateQueue.clear();
+        gateQueue.push_back(cell);
+        for (size_t head = 0; head < gateQueue.size() && gateQueue.size() < (size_t)SQUAD_GATE_SEARCH; head++) {
+            int current = gateQueue[head];
+            Cell* walls = maze.GetCell(current / height, current % height);
+            for (int side = 0; side < 4; side++) {
+                if (walls->walls[side]) continue;
+                int next = (current / height + SIDE_DX[side]) * height + current % height + SIDE_DY[side];
+                if (owner[next] != member) return next;
+                if (parent[next] == current) gateQueue.push_back(next);     // away from the chaser
+            }
+        }
+        return -1;
+    }
+
+    // The first cell on the planned route from `cell` to `target`, read
+    // off the BFS tree; -1 when `cell` is not on that route
+    int RouteStep(int cell, int target) const {
+        for (int x = target; x >= 0; x = parent[x]) {
+            if (parent[x] == cell) return x;
+        }
+        return -1;
+    }
+
+public:
+    explicit PoliceSquad(WorkerPool* workerPool = nullptr) : pool(workerPool) {}
+
+    static int GetMemberCount(WorldState& world) { return 1 + (int)world.GetHeader().policeCount; }
+    static Player& Member(WorldState& world, int member) {
+        return member == 0 ? world.GetHeader().player : world.GetPolice()[member - 1];
+    }
+    Mode GetMode(int member) const { return member < (int)orders.size() ? orders[member].mode : PATROL; }
+    const Stats& GetStats() const { return stats; }
+
+    // Forgets sightings, cell lists and plans. The world they describe is
+    // gone after a new maze, a restore or a rewind, and the cell lists are
+    // stamped by tick, which a rewind takes back to values already used.
+    void Reset() {
+        for (auto& seen : lastSeen) seen.store(0, std::memory_order_relaxed);
+        for (auto& head : cellHead) head.store(0, std::memory_order_relaxed);
+        std::fill(owner.begin(), owner.end(), -1);
+        std::fill(parent.begin(), parent.end(), -1);
+        std::fill(orders.begin(), orders.end(), Order());
+        std::fill(patrolTargets.begin(), patrolTargets.end(), -1);
+        planned = false;
+    }
+
+    // Rebuilds the cell lists and updates the sighting map from what every
+    // member sees
+    void Observe(WorldState& world, MazeGenerator& maze) {
+        Prepare(world);
+        auto start = std::chrono::steady_clock::now();
+        listStamp = Stamp(world.GetHeader().tick);
+        const uint64_t stamp = listStamp;
+        NpcList bandits = world.GetNpcList();
+        ForEach((int)bandits.size(), 1024, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                int cell = PoliceAutopilot::CellIndex(maze, bandits[i].position);
+                uint64_t head = cellHead[cell].exchange(stamp << 32 | (uint64_t)(i + 1), std::memory_order_relaxed);
+                banditNext[i] = (uint32_t)(head >> 32) == stamp ? (uint32_t)head : 0;
+            }
+        });
+
+        const int height = maze.GetHeight();
+        auto look = [&](int cell) {
+            if (FirstBandit(cell)) lastSeen[cell].store(listStamp, std::memory_order_relaxed);
+            else if (lastSeen[cell].load(std::memory_order_relaxed)) {
+                lastSeen[cell].store(0, std::memory_order_relaxed);
+            }
+        };
+        ForEach(GetMemberCount(world), 8, [&](int begin, int end) {
+            for (int member = begin; member < end; member++) {
+                int cell = PoliceAutopilot::CellIndex(maze, Member(world, member).position);
+                look(cell);
+                for (int side = 0; side < 4; side++) {
+                    int x = cell / height;
+                    int y = cell % height;
+                    for (int step = 0; step < SQUAD_SIGHT && !maze.GetCell(x, y)->walls[side]; step++) {
+                        x += SIDE_DX[side];
+                        y += SIDE_DY[side];
+                        look(x * height + y);
+                    }
+                }
+            }
+        });
+        stats.observeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Splits the maze into regions and gives every member an order
+    void Plan(WorldState& world, MazeGenerator& maze) {
+        Prepare(world);
+        auto start = std::chrono::steady_clock::now();
+        const int height = maze.GetHeight();
+        const int members = GetMemberCount(world);
+        const uint32_t now = Stamp(world.GetHeader().tick);
+
+        std::fill(owner.begin(), owner.end(), -1);
+        queue.clear();
+        for (int member = 0; member < members; member++) {
+            patrolTargets[member] = orders[member].mode == PATROL ? orders[member].target : -1;
+            orders[member] = Order();
+            int cell = PoliceAutopilot::CellIndex(maze, Member(world, member).position);
+            if (owner[cell] >= 0) continue;
+            owner[cell] = member;
+            parent[cell] = -1;
+            queue.push_back(cell);
+        }
+        // Cells leave the queue nearest first, so a member's first sighting
+        // is its nearest and its last cell is the far end of its region
+        for (size_t head = 0; head < queue.size(); head++) {
+            int current = queue[head];
+            Order& order = orders[owner[current]];
+            if (order.mode != CHASE) {
+                uint32_t seen = lastSeen[current].load(std::memory_order_relaxed);
+                if (seen && now - seen < SQUAD_MEMORY_TICKS) order = {CHASE, current};
+                else order.target = current;
+            }
+            Cell* walls = maze.GetCell(current / height, current % height);
+            for (int side = 0; side < 4; side++) {
+                if (walls->walls[side]) continue;
+                int next = (current / height + SIDE_DX[side]) * height + current % height + SIDE_DY[side];
+                if (owner[next] >= 0) continue;
+                owner[next] = owner[current];
+                parent[next] = current;
+                queue.push_back(next);
+            }
+        }
+
+        // A patrol keeps its target until it gets there, so an officer sweeps
+        // its region end to end instead of turning as the region reshapes
+        for (int member = 0; member < members; member++) {
+            int target = patrolTargets[member];
+            if (orders[member].mode == PATROL && target >= 0 && owner[target] == member &&
+                parent[target] >= 0) {
+                orders[member].target = target;
+            }
+        }
+
+        // Send patrolling neighbours to the gates chased bandits would leave by
+        for (int member = 0; member < members; member++) {
+            if (orders[member].mode != CHASE) continue;
+            int gate = FindGate(maze, member, orders[member].target);
+            if (gate < 0) continue;
+            Order& neighbour = orders[owner[gate]];
+            if (neighbour.mode == PATROL) neighbour = {INTERCEPT, gate};
+        }
+        for (int member = 0; member < members; member++) stats.orders[orders[member].mode]++;
+        stats.plans++;
+        planned = true;
+        stats.planSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // The input that carries out a member's order
+    PlayerInput Think(WorldState& world, MazeGenerator& maze, int member) {
+        Prepare(world);
+        const int height = maze.GetHeight();
+        Vector3 position = Member(world, member).position;
+        int cell = PoliceAutopilot::CellIndex(maze, position);
+        Order& order = orders[member];
+        PlayerInput input;
+
+        if (order.target < 0) order.target = maze.Random((int)world.GetCellCount());
+        int next = order.target == cell ? cell : RouteStep(cell, order.target);
+        if (next < 0) next = pathfinder.NextStep(maze, cell, order.target, 2048);
+        if (next < 0) {
+            order.target = -1;
+            return input;
+        }
+
+        // Head for the next cell's centre; at the target, run at the nearest
+        // bandit there, or move on when there is none
+        Vector3 aim = {(next / height) * CELL_SIZE, position.y, (next % height) * CELL_SIZE};
+        if (next == cell) {
+            NpcList bandits = world.GetNpcList();
+            float best = 1e30f;
+            for (uint32_t i = FirstBandit(cell); i; i = banditNext[i - 1]) {
+                float dx = bandits[i - 1].position.x - position.x;
+                float dz = bandits[i - 1].position.z - position.z;
+                if (dx * dx + dz * dz < best) {
+                    best = dx * dx + dz * dz;
+                    aim = bandits[i - 1].position;
+                }
+            }
+            if (best == 1e30f) order = Order();
+        }
+        input.yaw = atan2f(aim.x - position.x, aim.z - position.z);
+        input.buttons = INPUT_FORWARD;
+        return input;
+    }
+
+    // Arrests the bandits within CAPTURE_RADIUS of any member, looking only
+    // at the cell lists around each member
+    int Arrest(WorldState& world, MazeGenerator& maze) {
+        const int width = maze.GetWidth();
+        const int height = maze.GetHeight();
+        NpcList bandits = world.GetNpcList();
+        int arrested = 0;
+        for (int member = 0; member < GetMemberCount(world); member++) {
+            Vector3 position = Member(world, member).position;
+            int cell = PoliceAutopilot::CellIndex(maze, position);
+            for (int x = std::max(0, cell / height - 1); x <= std::min(width - 1, cell / height + 1); x++) {
+                for (int y = std::max(0, cell % height - 1); y <= std::min(height - 1, cell % height + 1); y++) {
+                    for (uint32_t i = FirstBandit(x * height + y); i; i = banditNext[i - 1]) {
+                        NPC& bandit = bandits[i - 1];
+                        float dx = bandit.position.x - position.x;
+                        float dz = bandit.position.z - position.z;
+                        if (dx * dx + dz * dz > CAPTURE_RADIUS * CAPTURE_RADIUS) continue;
+                        RespawnBandit(bandit, position, maze);
+                        arrested++;
+                    }
+                }
+            }
+        }
+        return arrested;
+    }
+
+    // One fixed step of a squad game, in place of StepWorld: the player's
+    // input, the officers' orders, the bandits (each fleeing the member
+    // whose region it is in), sightings and arrests
+    void Step(WorldState& world, MazeGenerator& maze, const PlayerInput& input, float dt) {
+        Prepare(world);
+        WorldState::Header& header = world.GetHeader();
+        if (!planned) Plan(world, maze);
+        ApplyPlayerInput(header.player, maze, input, dt);
+        for (int member = 1; member < GetMemberCount(world); member++) {
+            ApplyPlayerInput(Member(world, member), maze, Think(world, maze, member), dt);
+        }
+        for (NPC& npc : world.GetNpcList()) {
+            int threat = owner[PoliceAutopilot::CellIndex(maze, npc.position)];
+            npc.Think(maze, Member(world, std::max(threat, 0)).position, dt);
+            npc.Update(maze, dt);
+        }
+        crowd.Apply(maze, world.GetNpcList());
+        Observe(world, maze);
+        header.captures += Arrest(world, maze);
+        if (header.tick % SQUAD_PLAN_TICKS == 0) Plan(world, maze);
+        header.tick++;
+        stats.ticks++;
+    }
+};
+
+// Squad scaling: `policeCount` AI officers plus an autopiloted player
+// against `banditCount` bandits for `seconds` of play, stepped as fast as
+// possible. Reports the tick cost against the 60 Hz budget and the arrest
+// rate.
+int RunSquadBenchmark(int policeCount, int banditCount, int mazeSize, double seconds, uint32_t seed) {
+    WorldState world;
+    MazeGenerator maze;
+    SetupWorld(world, maze, seed, mazeSize, banditCount, policeCount);
+    WorkerPool pool;
+    PoliceSquad squad(&pool);
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    // At least one tick, so the quantiles below have something to read
+    const int ticks = std::max(1, (int)(seconds * SERVER_TICK_RATE));
+    seconds = (double)ticks / SERVER_TICK_RATE;
+
+    std::vector<float> tickMs;
+    tickMs.reserve(ticks);
+    auto start = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < ticks; tick++) {
+        auto tickStart = std::chrono::steady_clock::now();
+        squad.Step(world, maze, squad.Think(world, maze, 0), dt);
+        auto tickEnd = std::chrono::steady_clock::now();
+        tickMs.push_back(std::chrono::duration<float, std::milli>(tickEnd - tickStart).count());
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const PoliceSquad::Stats& stats = squad.GetStats();
+    uint64_t orderTotal = std::max<uint64_t>(1, stats.orders[0] + stats.orders[1] + stats.orders[2]);
+    std::sort(tickMs.begin(), tickMs.end());
+    printf("Squad: %d officers + player vs %d bandits, %dx%d maze, %.0f s of play, %d threads\n", policeCount,
+           banditCount, mazeSize, mazeSize, seconds, pool.GetThreadCount());
+    printf("  tick: p50 %.3f ms, p99 %.3f ms, max %.3f ms (budget %.2f ms)\n", tickMs[tickMs.size() / 2],
+           tickMs[tickMs.size() * 99 / 100], tickMs.back(), 1000.0f / SERVER_TICK_RATE);
+    printf("  per tick: observe %.3f ms, plan %.3f ms (every %d ticks)\n", stats.observeSeconds * 1e3 / ticks,
+           stats.planSeconds * 1e3 / std::max<uint64_t>(1, stats.plans), SQUAD_PLAN_TICKS);
+    printf("  orders: %.0f%% chase, %.0f%% intercept, %.0f%% patrol\n",
+           100.0 * stats.orders[PoliceSquad::CHASE] / orderTotal,
+           100.0 * stats.orders[PoliceSquad::INTERCEPT] / orderTotal,
+           100.0 * stats.orders[PoliceSquad::PATROL] / orderTotal);
+    printf("  %u arrests (%.1f per officer per minute), %.0fx real time\n", world.GetHeader().captures,
+           world.GetHeader().captures * 60.0 / (seconds * (policeCount + 1)), seconds / std::max(wallSeconds, 1e-9));
+    return tickMs[tickMs.size() * 99 / 100] < 1000.0f / SERVER_TICK_RATE ? 0 : 1;
+}
+
+// Fill `count` pixels with one colour, four at a time where SSE2 is available
+static inline void FillPixels(Color* dst, int count, Color color) {
+    if (count <= 0) return;
+#ifdef MAZE_USE_SSE2
+    uint32_t packed;
+    memcpy(&packed, &color, sizeof(packed));
+    __m128i wide = _mm_set1_epi32((int)packed);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), wide);
+    }
+    for (; i < count; i++) dst[i] = color;
+#else
+    std::fill(dst, dst + count, color);
+#endif
+}
+
+// Software renderer for GPU-less machines. The maze is a flat grid with walls on
+// cell edges and a uniform WALL_HEIGHT, so each screen column is one DDA ray.
+// Columns are rendered into a column-major buffer (contiguous vertical spans),
+// then transposed into a row-major image for UpdateTexture/ExportImage.
+class CpuRaycaster {
+private:
+    struct Sprite {
+        float depth;
+        float centerX;
+        float centerY;
+        float radius;
+        Color color;
+    };
+
+    WorkerPool& pool;
+    int width = 0;
+    int height = 0;
+    std::vector<Color> columns;
+    std::vector<Color> pixels;
+    std::vector<float> depthBuffer;
+    std::vector<Sprite> sprites;
+
+    Color skyColor = SKYBLUE;
+    Color floorColor = DARKGREEN;
+    Color wallColorLit = DARKGRAY;
+    Color wallColorShaded = {64, 64, 64, 255};
+    Color edgeColor = BLACK;
+
+    // Distance along the ray to the first closed wall edge, in world units
+    static float CastRay(MazeGenerator& maze, float originX, float originZ, float dirX, float dirZ,
+                         bool& hitSideX, float& hitAlong) {
+        float gx = originX / CELL_SIZE + 0.5f;
+        float gz = originZ / CELL_SIZE + 0.5f;
+        int mapX = (int)floorf(gx);
+        int mapY = (int)floorf(gz);
+
+        float deltaX = (dirX == 0.0f) ? 1e30f : fabsf(1.0f / dirX);
+        float deltaZ = (dirZ == 0.0f) ? 1e30f : fabsf(1.0f / dirZ);
+        int stepX = dirX < 0 ? -1 : 1;
+        int stepY = dirZ < 0 ? -1 : 1;
+        float sideX = dirX < 0 ? (gx - mapX) * deltaX : (mapX + 1.0f - gx) * deltaX;
+        float sideZ = dirZ < 0 ? (gz - mapY) * deltaZ : (mapY + 1.0f - gz) * deltaZ;
+
+        const int maxSteps = 2 * (maze.GetWidth() + maze.GetHeight()) + 4;
+        float dist = 0.0f;
+        hitSideX = true;
+        for (int i = 0; i < maxSteps; i++) {
+            Cell* cell = maze.GetCell(mapX, mapY);
+            if (!cell) break;
+
+            if (sideX < sideZ) {
+                dist = sideX;
+                hitSideX = true;
+                if (cell->walls[stepX > 0 ? 1 : 3]) break;
+                sideX += deltaX;
+                mapX += stepX;
+            }
+            else {
+                dist = sideZ;
+                hitSideX = false;
+                if (cell->walls[stepY > 0 ? 0 : 2]) break;
+                sideZ += deltaZ;
+                mapY += stepY;
+            }
+        }
+
+        // Position of the hit along the wall face, in [0, 1) of one cell
+        float along = hitSideX ? gz + dist * dirZ : gx + dist * dirX;
+        hitAlong = along - floorf(along);
+        return dist * CELL_SIZE;
+    }
+
+    void RenderColumns(MazeGenerator& maze, int begin, int end, Vector3 eye, float forwardX, float forwardZ,
+                       float rightX, float rightZ, float tanHalfWidth, float focal, float horizon) {
+        for (int col = begin; col < end; col++) {
+            Color* column = &columns[(size_t)col * height];
+            float ndc = (2.0f * (col + 0.5f) / width - 1.0f) * tanHalfWidth;
+            float dirX = forwardX + rightX * ndc;
+            float dirZ = forwardZ + rightZ * ndc;
+
+            bool sideX;
+            float along;
+            float dist = CastRay(maze, eye.x, eye.z, dirX, dirZ, sideX, along);
+            if (dist < 0.01f) dist = 0.01f;
+            depthBuffer[col] = dist;
+
+            int top = (int)(horizon - (WALL_HEIGHT - eye.y) * focal / dist);
+            int bottom = (int)(horizon + eye.y * focal / dist);
+            int wallTop = ClampInt(top, 0, height);
+            int wallBottom = ClampInt(bottom, 0, height);
+
+            // Dark rims at the wall ends stand in for the wireframe overlay
+            float rim = (WALL_THICKNESS * 0.5f) / CELL_SIZE;
+            bool atEdge = along < rim || along > 1.0f - rim;
+            Color wall = atEdge ? edgeColor : (sideX ? wallColorShaded : wallColorLit);
+
+            FillPixels(column, wallTop, skyColor);
+            FillPixels(column + wallTop, wallBottom - wallTop, wall);
+            FillPixels(column + wallBottom, height - wallBottom, floorColor);
+            if (top >= 0 && top < height) column[top] = edgeColor;
+            if (bottom >= 0 && bottom < height) column[bottom] = edgeColor;
+
+            // Sprites are sorted far to near, so nearer ones overwrite
+            for (const Sprite& sprite : sprites) {
+                if (sprite.depth >= dist) continue;
+                float dx = col + 0.5f - sprite.centerX;
+                if (dx * dx >= sprite.radius * sprite.radius) continue;
+                float halfSpan = sqrtf(sprite.radius * sprite.radius - dx * dx);
+                int y0 = ClampInt((int)(sprite.centerY - halfSpan), 0, height);
+                int y1 = ClampInt((int)(sprite.centerY + halfSpan), 0, height);
+                FillPixels(column + y0, y1 - y0, sprite.color);
+            }
+        }
+    }
+
+    static int ClampInt(int value, int low, int high) {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+    void AddSprite(Vector3 pos, float radius, Color color, Vector3 eye, float forwardX, float forwardZ,
+                   float rightX, float rightZ, float tanHalfWidth, float focal, float horizon) {
+        float relX = pos.x - eye.x;
+        float relZ = pos.z - eye.z;
+        float depth = relX * forwardX + relZ * forwardZ;
+        if (depth < 0.05f) return;
+
+        float ndc = (relX * rightX + relZ * rightZ) / (depth * tanHalfWidth);
+        Sprite sprite;
+        sprite.depth = depth;
+        sprite.centerX = (ndc + 1.0f) * 0.5f * width;
+        sprite.centerY = horizon - (pos.y - eye.y) * focal / depth;
+        sprite.radius = radius * focal / depth;
+        sprite.color = color;
+        if (sprite.centerX + sprite.radius < 0 || sprite.centerX - sprite.radius > width) return;
+        sprites.push_back(sprite);
+    }
+
+public:
+    explicit CpuRaycaster(WorkerPool& workerPool) : pool(workerPool) {}
+
+    void Resize(int newWidth, int newHeight) {
+        MemoryScope scope(MemoryTag::TEXTURES);
+        if (newWidth == width && newHeight == height) return;
+        width = newWidth;
+        height = newHeight;
+        columns.assign((size_t)width * height, skyColor);
+        pixels.assign((size_t)width * height, skyColor);
+        depthBuffer.assign(width, 0.0f);
+    }
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    const Color* GetPixels() const { return pixels.data(); }
+
+    void Render(MazeGenerator& maze, const Camera3D& camera, NpcList npcs) {
+        Vector3 eye = camera.position;
+        Vector3 look = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+        float horizontalLength = sqrtf(look.x * look.x + look.z * look.z);
+        if (horizontalLength < 1e-4f) horizontalLength = 1e-4f;
+        float forwardX = look.x / horizontalLength;
+        float forwardZ = look.z / horizontalLength;
+        // Screen-right as raylib's look-at view matrix defines it
+        float rightX = -forwardZ;
+        float rightZ = forwardX;
+
+        float tanHalfHeight = tanf(camera.fovy * DEG2RAD * 0.5f);
+        float tanHalfWidth = tanHalfHeight * (float)width / height;
+        float focal = (height * 0.5f) / tanHalfHeight;
+        // Pitch becomes a vertical shear of the horizon line
+        float horizon = height * 0.5f - (look.y / horizontalLength) * focal;
+
+        sprites.clear();
+        for (const auto& npc : npcs) {
+            AddSprite(npc.position, PLAYER_RADIUS * 1.5f, npc.color, eye, forwardX, forwardZ,
+                      rightX, rightZ, tanHalfWidth, focal, horizon);
+            AddSprite(Vector3Add(npc.position, (Vector3){0, 0.5f, 0}), 0.1f, npc.GetStateColor(), eye,
+                      forwardX, forwardZ, rightX, rightZ, tanHalfWidth, focal, horizon);
+        }
+        std::sort(sprites.begin(), sprites.end(), [](const Sprite& a, const Sprite& b) { return a.depth > b.depth; });
+
+        pool.ParallelFor(width, 16, [&](int begin, int end) {
+            RenderColumns(maze, begin, end, eye, forwardX, forwardZ, rightX, rightZ, tanHalfWidth, focal, horizon);
+        });
+
+        // Transpose to row-major in 16x16 tiles, one band of rows per task
+        const int tile = 16;
+        pool.ParallelFor((height + tile - 1) / tile, 1, [&](int begin, int end) {
+            for (int band = begin; band < end; band++) {
+                int y0 = band * tile;
+                int y1 = std::min(y0 + tile, height);
+                for (int x0 = 0; x0 < width; x0 += tile) {
+                    int x1 = std::min(x0 + tile, width);
+                    for (int y = y0; y < y1; y++) {
+                        Color* row = &pixels[(size_t)y * width];
+                        for (int x = x0; x < x1; x++) {
+                            row[x] = columns[(size_t)x * height + y];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    bool Export(const char* fileName) const {
+        Image image = {(void*)pixels.data(), width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+        return ExportImage(image, fileName);
+    }
+};
+
+// 3D pass shared by the game loop and the benchmark (call inside BeginMode3D)
+void DrawScene(MazeMesh& mazeMesh, const MaterialAtlas& atlas, NpcList npcs) {
+    // Draw maze walls and floor
+    mazeMesh.Draw(atlas);
+
+    // Draw NPCs
+    for (auto& npc : npcs) {
+        npc.Draw(atlas);
+    }
+}
+
+// Other police from a network snapshot (the local player is the camera)
+void DrawPolice(const std::vector<NetPlayer>& players, uint16_t selfId, const MaterialAtlas& atlas) {
+    for (const auto& other : players) {
+        if (other.id == selfId) continue;
+        DrawAtlasSphere(other.position, PLAYER_RADIUS * 1.5f, 16, 16, atlas, ATLAS_WHITE, BLUE);
+        renderStats.drawCalls++;
+    }
+}
+
+// Squad officers of the local game
+void DrawPolice(const Player* officers, int count, const MaterialAtlas& atlas) {
+    for (int i = 0; i < count; i++) {
+        DrawAtlasSphere(officers[i].position, PLAYER_RADIUS * 1.5f, 16, 16, atlas, ATLAS_WHITE, BLUE);
+        renderStats.drawCalls++;
+    }
+}
+
+// Camera route for the benchmark: the maze path from cell (0, 0) to the cell
+// farthest from it, smoothed with a Catmull-Rom spline through cell centres
+class FlythroughPath {
+private:
+    std::vector<Vector3> points;
+
+public:
+    void Build(MazeGenerator& maze) {
+        int width = maze.GetWidth();
+        int height = maze.GetHeight();
+        std::vector<int> parent((size_t)width * height, -1);
+        std::vector<int> queue;
+        queue.reserve(parent.size());
+        queue.push_back(0);
+        parent[0] = 0;
+
+        // BFS over open walls; the last cell dequeued is the farthest one
+        for (size_t head = 0; head < queue.size(); head++) {
+            int x = queue[head] / height;
+            int y = queue[head] % height;
+            Cell* cell = maze.GetCell(x, y);
+            for (int side = 0; side < 4; side++) {
+                if (cell->walls[side]) continue;
+                int nx = x + SIDE_DX[side];
+                int ny = y + SIDE_DY[side];
+                if (!maze.GetCell(nx, ny)) continue;
+                int next = nx * height + ny;
+                if (parent[next] != -1) continue;
+                parent[next] = queue[head];
+                queue.push_back(next);
+            }
+        }
+
+        points.clear();
+        for (int index = queue.back(); ; index = parent[index]) {
+            points.push_back({(index / height) * CELL_SIZE, 0.0f, (index % height) * CELL_SIZE});
+            if (index == 0) break;
+        }
+        std::reverse(points.begin(), points.end());
+        if (points.size() < 2) points.push_back(points.front());
+    }
+
+    float GetLength() const { return (float)(points.size() - 1) * CELL_SIZE; }
+
+    // Point at `distance` world units along the route (wraps at the end)
+    Vector3 Sample(float distance) const {
+        float t = fmodf(distance / CELL_SIZE, (float)(points.size() - 1));
+        int last = (int)points.size() - 1;
+        int i = std::min((int)t, last - 1);
+        float u = t - i;
+        const Vector3& p0 = points[std::max(i - 1, 0)];
+        const Vector3& p1 = points[i];
+        const Vector3& p2 = points[i + 1];
+        const Vector3& p3 = points[std::min(i + 2, last)];
+
+        float u2 = u * u;
+        float u3 = u2 * u;
+        auto spline = [&](float a, float b, float c, float d) {
+            return 0.5f * (2.0f * b + (c - a) * u + (2.0f * a - 5.0f * b + 4.0f * c - d) * u2 +
+                           (3.0f * b - a - 3.0f * c + d) * u3);
+        };
+        return {spline(p0.x, p1.x, p2.x, p3.x), spline(p0.y, p1.y, p2.y, p3.y), spline(p0.z, p1.z, p2.z, p3.z)};
+    }
+};
+
+struct BenchmarkOptions {
+    std::vector<int> seeds = {1, 2, 3};
+    std::vector<int> sizes = {20, 64};
+    int frames = 600;
+    int warmupFrames = 30;
+    int width = 800;
+    int height = 600;
+    bool cpuRenderer = false;
+    bool autopilot = false;     // camera rides an autopilot police officer instead of the flythrough
+    std::string csvPath = "benchmark.csv";
+};
+
+// Comma-separated integers; false when an entry is not a number
+static bool ParseIntList(const char* text, std::vector<int>& values) {
+    values.clear();
+    for (const char* p = text; *p; ) {
+        char* end;
+        long value = strtol(p, &end, 10);
+        if (end == p || (*end && *end != ',')) return false;
+        values.push_back((int)value);
+        p = *end ? end + 1 : end;
+    }
+    return !values.empty();
+}
+
+// One integer in [low, high]; false when the text is anything else
+static bool ParseInt(const char* text, long low, long high, int& value) {
+    char* end;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end || parsed < low || parsed > high) return false;
+    value = (int)parsed;
+    return true;
+}
+
+// One finite number in [low, high]; false when the text is anything else
+static bool ParseNumber(const char* text, double low, double high, double& value) {
+    char* end;
+    double parsed = strtod(text, &end);
+    if (end == text || *end || !std::isfinite(parsed) || parsed < low || parsed > high) return false;
+    value = parsed;
+    return true;
+}
+
+static std::vector<float> ParseFloatList(const char* text) {
+    std::vector<float> values;
+    for (const char* p = text; *p; ) {
+        values.push_back((float)atof(p));
+        while (*p && *p != ',') p++;
+        if (*p == ',') p++;
+    }
+    return values;
+}
+
+static float Percentile(std::vector<float> values, float fraction) {
+    if (values.empty()) return 0.0f;
+    size_t index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Unattended benchmark: renders a fixed camera flythrough (or, with
+// --bench-autopilot, the view of an autopilot officer) offscreen for every
+// seed/size pair and writes per-frame timings to CSV. Timings per frame:
+//   sim_ms    - NPC think/update at a fixed 60 Hz step
+//   submit_ms - CPU time to record the 3D pass (or run the CPU raycaster)
+//   gpu_ms    - flush + present until EndDrawing returns; with no vsync this
+//               blocks on the GL driver, so it tracks GPU/llvmpipe cost
+// Run headless with e.g. `xvfb-run -a ./MazeRunnerPOLICE --bench`.
+int RunBenchmark(const BenchmarkOptions& options) {
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<float, std::milli>(b - a).count();
+    };
+
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(options.width, options.height, "Maze Explorer - Benchmark");
+
+    RenderTexture2D target = LoadRenderTexture(options.width, options.height);
+    MaterialAtlas atlas;
+    atlas.BeginLoad();
+    atlas.Update(true);
+    WorkerPool workerPool;
+    CpuRaycaster raycaster(workerPool);
+    raycaster.Resize(options.width, options.height);
+    Image blankFrame = GenImageColor(options.width, options.height, BLACK);
+    Texture2D cpuFrame = LoadTextureFromImage(blankFrame);
+    UnloadImage(blankFrame);
+
+    FILE* csv = fopen(options.csvPath.c_str(), "w");
+    if (csv) fprintf(csv, "renderer,seed,size,frame,sim_ms,submit_ms,gpu_ms,frame_ms,draw_calls\n");
+    const char* rendererName = options.cpuRenderer ? "cpu" : "gl";
+    const float dt = 1.0f / 60.0f;
+
+    printf("%-4s %6s %5s %10s %10s %10s %10s %10s %8s\n", "rndr", "seed", "size", "sim", "submit", "gpu",
+           "frame p50", "frame p95", "draws");
+
+    for (int size : options.sizes) {
+        for (int seed : options.seeds) {
+            srand((unsigned)seed);
+            MazeGenerator maze;
+            maze.Seed((uint64_t)seed);
+            maze.Initialize(size, size);
+            maze.Generate();
+
+            FlythroughPath path;
+            path.Build(maze);
+            MazeMesh mazeMesh;
+            mazeMesh.Build(maze);
+
+            std::vector<NPC> npcs;
+            int npcCount = std::max(10, size * size / 40);
+            for (int i = 0; i < npcCount; i++) {
+                NPC npc;
+                npc.position = maze.GetRandomSpawnPosition();
+                npc.target = maze.GetRandomSpawnPosition();
+                npc.color = (Color){(unsigned char)(rand() % 200 + 55),
+                                   (unsigned char)(rand() % 200 + 55),
+                                   (unsigned char)(rand() % 200 + 55), 255};
+                npcs.push_back(npc);
+            }
+
+            Camera3D camera = {};
+            camera.up = {0.0f, 1.0f, 0.0f};
+            camera.fovy = 60.0f;
+            camera.projection = CAMERA_PERSPECTIVE;
+
+            Player police;
+            police.position = maze.GetRandomSpawnPosition();
+            PoliceAutopilot pilot;
+            MazePathfinder pathfinder;
+            int arrests = 0;
+
+            std::vector<float> simTimes, submitTimes, gpuTimes, frameTimes;
+            double drawCallTotal = 0.0;
+
+            for (int frame = 0; frame < options.warmupFrames + options.frames; frame++) {
+                auto frameStart = Clock::now();
+                renderStats.Reset();
+
+                Vector3 eye, ahead;
+                if (options.autopilot) {
+                    ApplyPlayerInput(police, maze, pilot.Think(maze, pathfinder, police.position, npcs), dt);
+                    eye = police.position;
+                    ahead = {eye.x + sinf(police.yaw) * 0.75f, eye.y, eye.z + cosf(police.yaw) * 0.75f};
+                }
+                else {
+                    float travelled = frame * dt * PLAYER_SPEED;
+                    eye = path.Sample(travelled);
+                    ahead = path.Sample(travelled + 0.75f);
+                }
+                camera.position = {eye.x, PLAYER_HEIGHT / 2 + CAMERA_HEIGHT, eye.z};
+                camera.target = {ahead.x, camera.position.y, ahead.z};
+
+                for (auto& npc : npcs) {
+                    npc.Think(maze, eye, dt);
+                    npc.Update(maze, dt);
+                }
+                if (options.autopilot) arrests += CaptureBandits(eye, npcs, maze);
+                auto simEnd = Clock::now();
+
+                BeginDrawing();
+                if (options.cpuRenderer) {
+                    raycaster.Render(maze, camera, npcs);
+                    UpdateTexture(cpuFrame, raycaster.GetPixels());
+                    renderStats.drawCalls++;
+                }
+                else {
+                    BeginTextureMode(target);
+                        ClearBackground(SKYBLUE);
+                        BeginMode3D(camera);
+                            DrawScene(mazeMesh, atlas, npcs);
+                        EndMode3D();
+                    EndTextureMode();
+                }
+                auto submitEnd = Clock::now();
+
+                ClearBackground(BLACK);
+                if (options.cpuRenderer) {
+                    DrawTexture(cpuFrame, 0, 0, WHITE);
+                }
+                else {
+                    Rectangle source = {0, 0, (float)options.width, -(float)options.height};
+                    Rectangle dest = {0, 0, (float)options.width, (float)options.height};
+                    DrawTexturePro(target.texture, source, dest, {0, 0}, 0.0f, WHITE);
+                }
+                EndDrawing();
+                auto frameEnd = Clock::now();
+
+                float simMs = ms(frameStart, simEnd);
+                float submitMs = ms(simEnd, submitEnd);
+                float gpuMs = ms(submitEnd, frameEnd);
+                float frameMs = ms(frameStart, frameEnd);
+                if (csv) {
+                    fprintf(csv, "%s,%d,%d,%d,%.4f,%.4f,%.4f,%.4f,%d\n", rendererName, seed, size, frame,
+                            simMs, submitMs, gpuMs, frameMs, renderStats.drawCalls);
+                }
+                if (frame < options.warmupFrames) continue;
+                simTimes.push_back(simMs);
+                submitTimes.push_back(submitMs);
+                gpuTimes.push_back(gpuMs);
+                frameTimes.push_back(frameMs);
+                drawCallTotal += renderStats.drawCalls;
+            }
+
+            printf("%-4s %6d %5d %10.3f %10.3f %10.3f %10.3f %10.3f %8.0f\n", rendererName, seed, size,
+                   Percentile(simTimes, 0.5f), Percentile(submitTimes, 0.5f), Percentile(gpuTimes, 0.5f),
+                   Percentile(frameTimes, 0.5f), Percentile(frameTimes, 0.95f),
+                   drawCallTotal / std::max<size_t>(1, frameTimes.size()));
+            if (options.autopilot) printf("     autopilot made %d arrests\n", arrests);
+            mazeMesh.Unload();
+        }
+    }
+
+    if (csv) {
+        fclose(csv);
+        printf("Per-frame timings written to %s\n", options.csvPath.c_str());
+    }
+
+    UnloadTexture(cpuFrame);
+    UnloadRenderTexture(target);
+    atlas.Unload();
+    CloseWindow();
+    return 0;
+}
+
+// Frame Settings
+const float FRAME_PERIOD_MS = 1000.0f / 60.0f;
+const int LATENCY_BUCKETS = 64;             // 1 ms each, last bucket collects the rest
+const int PROFILER_GRAPH_FRAMES = 120;
+const int PROFILER_RESERVE_FRAMES = 1 << 14;  // about 4.5 minutes at 60 Hz before the log first grows
+const int LATCHED_KEYS[] = {KEY_R, KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F9, KEY_F12};
+const int REWIND_FRAMES = 300;      // world snapshots kept for Backspace rewind
+const size_t ALLOC_TEST_REWIND_BYTES = 256u << 20;    // rewind ring cap for --alloc-test on huge worlds
+
+// Key presses across a mid-frame PollInputEvents. The late latch polls twice
+// per frame, and a press landing between the two polls would otherwise be
+// seen by neither IsKeyPressed check. Pressed() consumes a carried press.
+class KeyLatch {
+private:
+    bool carried[sizeof(LATCHED_KEYS) / sizeof(LATCHED_KEYS[0])] = {};
+
+public:
+    void Capture() {
+        for (size_t i = 0; i < sizeof(LATCHED_KEYS) / sizeof(LATCHED_KEYS[0]); i++) {
+            if (IsKeyPressed(LATCHED_KEYS[i])) carried[i] = true;
+        }
+    }
+
+    bool Pressed(int key) {
+        bool pressed = IsKeyPressed(key);
+        for (size_t i = 0; i < sizeof(LATCHED_KEYS) / sizeof(LATCHED_KEYS[0]); i++) {
+            if (LATCHED_KEYS[i] == key && carried[i]) {
+                carried[i] = false;
+                pressed = true;
+            }
+        }
+        return pressed;
+    }
+};
+
+// Per-frame timestamps (seconds since the profiler started) and an
+// input-to-present latency histogram, kept separately with and without late
+// latching. Latency runs from the poll that produced the camera's mouse
+// input to the return of the buffer swap.
+class FrameProfiler {
+public:
+    struct Frame {
+        double start;
+        double inputSample;     // GetMouseDelta at the top of the loop
+        double simEnd;
+        double latch;           // mid-frame re-poll, or 0 when not latching
+        double submit;          // just before EndDrawing
+        double swap;            // EndDrawing returned (swap + input poll)
+        float latencyMs;
+        bool lateLatch;
+        uint32_t allocations;   // operator new calls between BeginFrame and MarkSwap
+    };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point origin = Clock::now();
+    std::vector<Frame> frames;
+    Frame current = {};
+    double lastPoll = 0.0;
+    int histogram[2][LATENCY_BUCKETS] = {};
+    size_t maxFrames = 1 << 20;
+    uint64_t allocationsAtStart = 0;
+    uint64_t tagAllocationsAtStart[MEMORY_TAG_COUNT] = {};
+    uint32_t lastTagAllocations[MEMORY_TAG_COUNT] = {};
+    uint64_t steadyTagAllocations[MEMORY_TAG_COUNT] = {};     // after the first frame
+
+    double Now() const { return std::chrono::duration<double>(Clock::now() - origin).count(); }
+
+    static float Percentile(const int* buckets, float fraction) {
+        int total = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) total += buckets[i];
+        if (total == 0) return 0.0f;
+        int seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= fraction * total) return i + 1.0f;
+        }
+        return (float)LATENCY_BUCKETS;
+    }
+
+public:
+    bool showOverlay = false;
+
+    FrameProfiler() { frames.reserve(PROFILER_RESERVE_FRAMES); }
+
+    void BeginFrame() {
+        current = {};
+        current.start = Now();
+        allocationsAtStart = heapAllocations.load(std::memory_order_relaxed);
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            tagAllocationsAtStart[tag] = memoryAccounts[tag].allocations.load(std::memory_order_relaxed);
+        }
+        if (lastPoll == 0.0) lastPoll = current.start;
+    }
+
+    void MarkInput() { current.inputSample = Now(); }
+    void MarkSimEnd() { current.simEnd = Now(); }
+    void MarkSubmit() { current.submit = Now(); }
+
+    void MarkLatch() {
+        current.latch = Now();
+        current.lateLatch = true;
+    }
+
+    void MarkSwap() {
+        current.swap = Now();
+        current.allocations = (uint32_t)(heapAllocations.load(std::memory_order_relaxed) - allocationsAtStart);
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            uint64_t count = memoryAccounts[tag].allocations.load(std::memory_order_relaxed);
+            lastTagAllocations[tag] = (uint32_t)(count - tagAllocationsAtStart[tag]);
+            if (!frames.empty()) steadyTagAllocations[tag] += lastTagAllocations[tag];
+        }
+        double polled = current.lateLatch ? current.latch : lastPoll;
+        current.latencyMs = (float)((current.swap - polled) * 1000.0);
+        // EndDrawing polls input right after the swap
+        lastPoll = current.swap;
+
+        int bucket = std::min(LATENCY_BUCKETS - 1, (int)current.latencyMs);
+        histogram[current.lateLatch ? 1 : 0][bucket]++;
+        if (frames.size() < maxFrames) frames.push_back(current);
+    }
+
+    const Frame* GetLastFrame() const { return frames.empty() ? nullptr : &frames.back(); }
+
+    // Stacked bars for recent frames: sim, render/submit, present; the line marks the frame period
+    void DrawOverlay(int x, int y, const FrameArena& arena) const {
+        const int graphHeight = 80;
+        const float pixelsPerMs = graphHeight / (2.0f * FRAME_PERIOD_MS);
+        DrawRectangle(x, y, PROFILER_GRAPH_FRAMES * 2 + 10, graphHeight + 80 + MEMORY_TAG_COUNT * 12,
+                      Fade(BLACK, 0.6f));
+
+        size_t first = frames.size() > (size_t)PROFILER_GRAPH_FRAMES ? frames.size() - PROFILER_GRAPH_FRAMES : 0;
+        int baseY = y + 5 + graphHeight;
+        for (size_t i = first; i < frames.size(); i++) {
+            const Frame& f = frames[i];
+            int barX = x + 5 + (int)(i - first) * 2;
+            float sim = (float)(f.simEnd - f.start) * 1000.0f;
+            float render = (float)(f.submit - f.simEnd) * 1000.0f;
+            float present = (float)(f.swap - f.submit) * 1000.0f;
+            int simPixels = (int)(sim * pixelsPerMs);
+            int renderPixels = (int)(render * pixelsPerMs);
+            int presentPixels = std::min((int)(present * pixelsPerMs), graphHeight - simPixels - renderPixels);
+            DrawRectangle(barX, baseY - simPixels, 2, simPixels, GREEN);
+            DrawRectangle(barX, baseY - simPixels - renderPixels, 2, renderPixels, SKYBLUE);
+            DrawRectangle(barX, baseY - simPixels - renderPixels - presentPixels, 2, std::max(presentPixels, 0), ORANGE);
+        }
+        int periodY = baseY - (int)(FRAME_PERIOD_MS * pixelsPerMs);
+        DrawLine(x + 5, periodY, x + 5 + PROFILER_GRAPH_FRAMES * 2, periodY, WHITE);
+
+        DrawText("sim / render / present", x + 5, baseY + 5, 10, WHITE);
+        DrawText(TextFormat("latency p50/p95 %.0f/%.0f ms, latched %.0f/%.0f ms",
+                            Percentile(histogram[0], 0.5f), Percentile(histogram[0], 0.95f),
+                            Percentile(histogram[1], 0.5f), Percentile(histogram[1], 0.95f)),
+                 x + 5, baseY + 20, 10, WHITE);
+        if (const Frame* last = GetLastFrame()) {
+            DrawText(TextFormat("last frame: latency %.1f ms%s", last->latencyMs, last->lateLatch ? " (late latch)" : ""),
+                     x + 5, baseY + 35, 10, WHITE);
+            DrawText(TextFormat("heap allocs %u, frame arena %zu/%zu KB", last->allocations,
+                                arena.LastFrameBytes() / 1024, arena.Capacity() / 1024),
+                     x + 5, baseY + 50, 10, WHITE);
+        }
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            const MemoryAccount& account = memoryAccounts[tag];
+            DrawText(TextFormat("%-8s %7.0f KB, peak %7.0f KB, %u allocs", MEMORY_TAG_NAMES[tag],
+                                account.liveBytes.load(std::memory_order_relaxed) / 1024.0,
+                                account.peakBytes.load(std::memory_order_relaxed) / 1024.0, lastTagAllocations[tag]),
+                     x + 5, baseY + 65 + tag * 12, 10, lastTagAllocations[tag] ? ORANGE : WHITE);
+        }
+    }
+
+    void PrintReport(FILE* out) const {
+        const char* names[2] = {"input sampled at top of frame", "late latch before 3D pass"};
+        for (int mode = 0; mode < 2; mode++) {
+            int total = 0;
+            for (int i = 0; i < LATENCY_BUCKETS; i++) total += histogram[mode][i];
+            if (total == 0) continue;
+            fprintf(out, "Input-to-present latency, %s (%d frames): p50 %.0f ms, p95 %.0f ms, p99 %.0f ms\n",
+                    names[mode], total, Percentile(histogram[mode], 0.5f), Percentile(histogram[mode], 0.95f),
+                    Percentile(histogram[mode], 0.99f));
+            for (int i = 0; i < LATENCY_BUCKETS; i++) {
+                if (histogram[mode][i] == 0) continue;
+                int bar = (int)(60.0f * histogram[mode][i] / total + 0.5f);
+                fprintf(out, "  %2d%s ms %6d %s\n", i, i == LATENCY_BUCKETS - 1 ? "+" : " ", histogram[mode][i],
+                        std::string(bar, '#').c_str());
+            }
+        }
+
+        // The first frame builds caches and fills buffers; after it, frames should not allocate
+        uint64_t allocations = 0;
+        size_t allocatingFrames = 0;
+        for (size_t i = 1; i < frames.size(); i++) {
+            allocations += frames[i].allocations;
+            if (frames[i].allocations > 0) allocatingFrames++;
+        }
+        if (frames.size() > 1) {
+            fprintf(out, "Heap allocations after the first frame: %llu, in %zu of %zu frames\n",
+                    (unsigned long long)allocations, allocatingFrames, frames.size() - 1);
+            for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+                if (steadyTagAllocations[tag] == 0) continue;
+                fprintf(out, "  %s: %llu\n", MEMORY_TAG_NAMES[tag], (unsigned long long)steadyTagAllocations[tag]);
+            }
+        }
+    }
+
+    bool WriteCsv(const char* fileName) const {
+        FILE* csv = fopen(fileName, "w");
+        if (!csv) return false;
+        fprintf(csv, "frame,start,input,sim_end,latch,submit,swap,latency_ms,late_latch,allocations\n");
+        for (size_t i = 0; i < frames.size(); i++) {
+            const Frame& f = frames[i];
+            fprintf(csv, "%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%d,%u\n", i, f.start, f.inputSample, f.simEnd,
+                    f.latch, f.submit, f.swap, f.latencyMs, f.lateLatch ? 1 : 0, f.allocations);
+        }
+        fclose(csv);
+        return true;
+    }
+};
+
+// Dynamic resolution: the 3D pass renders into the lower-left part of a
+// window-sized RenderTexture2D and is upscaled on present, while the HUD and
+// minimap draw at native resolution. The scale follows measured frame work
+// time towards a target, falling quickly on overruns and rising slowly.
+class DynamicResolution {
+private:
+    RenderTexture2D target = {};
+    int nativeWidth = 0;
+    int nativeHeight = 0;
+    float scale = 1.0f;
+    float smoothedMs = 0.0f;
+
+    // RGBA8 colour plus a 32-bit depth buffer
+    int64_t TargetBytes() const { return (int64_t)nativeWidth * nativeHeight * 8; }
+
+public:
+    bool enabled = false;
+    float targetFrameMs = FRAME_PERIOD_MS;
+    float minScale = 0.5f;
+
+    void Load(int width, int height) {
+        nativeWidth = width;
+        nativeHeight = height;
+        target = LoadRenderTexture(width, height);
+        SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+        TrackMemory(MemoryTag::TEXTURES, TargetBytes());
+    }
+
+    void Unload() {
+        UnloadRenderTexture(target);
+        TrackMemory(MemoryTag::TEXTURES, -TargetBytes());
+        target = {};
+    }
+
+    float GetScale() const { return enabled ? scale : 1.0f; }
+    float GetSmoothedMs() const { return smoothedMs; }
+
+    // Render size rounded to multiples of 8 so small corrections don't churn
+    int GetRenderWidth() const {
+        if (!enabled) return nativeWidth;
+        return std::max(8, ((int)(nativeWidth * scale) + 4) / 8 * 8);
+    }
+
+    int GetRenderHeight() const {
+        if (!enabled) return nativeHeight;
+        return std::max(8, (int)((float)GetRenderWidth() * nativeHeight / nativeWidth + 0.5f));
+    }
+
+    void BeginScene() {
+        BeginTextureMode(target);
+        rlViewport(0, 0, GetRenderWidth(), GetRenderHeight());
+    }
+
+    void EndScene() {
+        EndTextureMode();
+    }
+
+    // Upscale the rendered region to the window (render textures are stored bottom-up)
+    void Present() {
+        Rectangle source = {0, 0, (float)GetRenderWidth(), -(float)GetRenderHeight()};
+        Rectangle dest = {0, 0, (float)nativeWidth, (float)nativeHeight};
+        DrawTexturePro(target.texture, source, dest, {0, 0}, 0.0f, WHITE);
+    }
+
+    // Feed the CPU+GPU work time of the last frame (excluding pacing sleep)
+    void Feedback(float workMs) {
+        smoothedMs = (smoothedMs == 0.0f) ? workMs : smoothedMs + 0.1f * (workMs - smoothedMs);
+        if (!enabled) return;
+
+        // Pixel cost goes with scale squared. Drop by up to 5% and rise by up to
+        // 2% per frame, with a dead band so the scale settles instead of oscillating
+        float ratio = targetFrameMs / std::max(smoothedMs, 0.01f);
+        if (ratio > 0.9f && ratio < 1.25f) return;
+        float step = Clamp(sqrtf(ratio), 0.95f, ratio > 1.0f ? 1.02f : 1.0f);
+        scale = Clamp(scale * step, minScale, 1.0f);
+    }
+};
+
+// Steady-state allocation check: plays the local game's per-frame work
+// headless (autopilot, world step with crowd separation, rewind saves, frame
+// arena) alone and with a squad, and fails if any frame after the first
+// second touches the heap. Online play is not covered; the counters are
+// process-wide and a loopback server would share them
+int RunAllocationTest(double seconds, uint32_t seed, int mazeSize, int npcCount) {
+    const float dt = 1.0f / SERVER_TICK_RATE;
+    const int ticks = (int)(seconds * SERVER_TICK_RATE);
+    const int warmupTicks = SERVER_TICK_RATE;
+    WorkerPool pool;
+    int failures = 0;
+    for (int squadSize : {0, 3}) {
+        WorldState world;
+        MazeGenerator maze;
+        SetupWorld(world, maze, seed, mazeSize, npcCount, squadSize);
+        CorridorGraph corridors;
+        corridors.Build(maze);
+        MazePathfinder pathfinder;
+        pathfinder.UseGraph(&corridors);
+        PoliceAutopilot pilot;
+        PoliceSquad squad(&pool);
+        CrowdSeparation crowd;
+        FrameArena frameArena;
+        // The game's rewind ring, shortened so huge worlds stay within ALLOC_TEST_REWIND_BYTES
+        size_t rewindFrames = std::max<size_t>(2, ALLOC_TEST_REWIND_BYTES / world.GetSize());
+        std::vector<std::vector<uint64_t>> rewindHistory(std::min<size_t>(REWIND_FRAMES, rewindFrames));
+        for (auto& snapshot : rewindHistory) world.Save(snapshot);
+
+        uint64_t tagCounts[MEMORY_TAG_COUNT] = {};
+        int allocatingTicks = 0;
+        uint64_t allocations = 0;
+        for (int tick = 0; tick < warmupTicks + ticks; tick++) {
+            uint64_t before[MEMORY_TAG_COUNT];
+            for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+                before[tag] = memoryAccounts[tag].allocations.load(std::memory_order_relaxed);
+            }
+            frameArena.Reset();
+            WorldState::Header& header = world.GetHeader();
+            if (squadSize > 0) {
+                squad.Step(world, maze, squad.Think(world, maze, 0), dt);
+            }
+            else {
+                PlayerInput input = pilot.Think(maze, pathfinder, header.player.position, world.GetNpcList());
+                StepWorld(world, maze, input, dt, &crowd);
+            }
+            world.Save(rewindHistory[tick % rewindHistory.size()]);
+            if (tick < warmupTicks) continue;
+
+            uint64_t tickAllocations = 0;
+            for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+                uint64_t count = memoryAccounts[tag].allocations.load(std::memory_order_relaxed) - before[tag];
+                tagCounts[tag] += count;
+                tickAllocations += count;
+            }
+            allocations += tickAllocations;
+            if (tickAllocations > 0) allocatingTicks++;
+        }
+
+        printf("Allocation test, %s: %d frames after warm-up, %llu allocations in %d frames\n",
+               squadSize > 0 ? "squad" : "solo", ticks, (unsigned long long)allocations, allocatingTicks);
+        for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+            if (tagCounts[tag] > 0) printf("  %s: %llu\n", MEMORY_TAG_NAMES[tag], (unsigned long long)tagCounts[tag]);
+        }
+        if (allocations > 0) failures++;
+    }
+    PrintMemoryReport(stdout);
+    printf("%s\n", failures ? "FAIL: steady-state frames allocated" : "PASS");
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
     srand(static_cast<unsigned>(time(nullptr)));
 
+    // Command line: --cpu-render starts on the software renderer,
+    // --dump-frames N writes the first N CPU frames to cpu_frame_###.png,
+    // --bench runs the offscreen flythrough benchmark and exits,
+    // --dynamic-res [ms] adapts the 3D render size to a frame-time target,
+    // --late-latch re-aims the camera just before the 3D pass,
+    // --latency-log file writes per-frame timestamps to CSV on exit,
+    // --server [port] runs a headless authoritative server,
+    // --loopback-test N runs a server plus N bots on localhost and reports,
+    // --connect host[:port] plays on a server,
+    // --snapshot-bench [npcs] measures the snapshot encoder offline,
+    // --state-bench [npcs] measures world arena save/restore,
+    // --rooms N runs N independent matches on a work-stealing scheduler
+    // (--room-threads, --room-seeds distinct mazes, --room-police per room),
+    // --bots N [host[:port]] load-tests a server with autopilot police
+    // (server options: --seed, --maze-size, --npcs, --duration seconds,
+    // --no-interest to send every NPC to every client),
+    // --latency ms, --jitter ms and --loss percent simulate a link for clients,
+    // --no-prediction shows the server's position of the local player
+    bool cpuRender = false;
+    bool lateLatch = false;
+    const char* latencyLog = nullptr;
+    int dumpFrames = 0;
+    DynamicResolution dynamicRes;
+    bool benchmark = false;
+    BenchmarkOptions benchOptions;
+    int serverPort = -1;
+    int loopbackBots = 0;
+    int snapshotBenchNpcs = 0;
+    int stateBenchNpcs = 0;
+    int roomCount = 0;
+    int botLoad = 0;
+    const char* botServer = "127.0.0.1";
+    int roomThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+    int roomSeeds = 16;
+    int roomPolice = 4;
+    const char* connectAddress = nullptr;
+    uint32_t serverSeed = (uint32_t)time(nullptr);
+    int serverMazeSize = MAZE_WIDTH;
+    int serverNpcs = 10;
+    double serverDuration = 0.0;
+    bool interestManagement = true;
+    LinkConditions link;
+    bool usePrediction = true;
+    bool autopilot = false;
+    int squadSize = 0;
+    int squadBenchPolice = 0;
+    int crowdBenchAgents = 0;
+    int pathBenchSize = 0;
+    int hierarchyBenchSize = 0;
+    int layoutBenchSize = 0;
+    int hugePageBenchSize = 0;
+    bool interleavePages = false;
+    bool fixedBench = false;
+    double soakSeconds = 0.0;
+    double allocTestSeconds = 0.0;
+    int monteCarloMatches = 0;
+    int monteCarloThreads = roomThreads;
+    const char* monteCarloCsv = "montecarlo.csv";
+    std::vector<float> sweepPlayerSpeed = {PLAYER_SPEED};
+    std::vector<float> sweepBanditSpeed = {MatchConfig().banditSpeed};
+    std::vector<float> sweepFlee = {MatchConfig().fleeDistance};
+    std::vector<float> sweepChase = {MatchConfig().chaseDistance};
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cpu-render") == 0) cpuRender = true;
+        else if (strcmp(argv[i], "--dump-frames") == 0 && i + 1 < argc) {
+            dumpFrames = atoi(argv[++i]);
+            cpuRender = true;
+        }
+        else if (strcmp(argv[i], "--dynamic-res") == 0) {
+            dynamicRes.enabled = true;
+            double targetMs = dynamicRes.targetFrameMs;
+            // Options start with "--", so a negative target is still read (and rejected)
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                if (!ParseNumber(argv[++i], 0.0, HUGE_VAL, targetMs) || targetMs <= 0.0) {
+                    fprintf(stderr, "Bad --dynamic-res target %s (milliseconds, above 0)\n", argv[i]);
+                    return 1;
+                }
+            }
+            dynamicRes.targetFrameMs = (float)targetMs;
+        }
+        else if (strcmp(argv[i], "--late-latch") == 0) lateLatch = true;
+        else if (strcmp(argv[i], "--latency-log") == 0 && i + 1 < argc) latencyLog = argv[++i];
+        else if (strcmp(argv[i], "--bench") == 0) benchmark = true;
+        else if (strcmp(argv[i], "--bench-cpu") == 0) benchOptions.cpuRenderer = true;
+        else if (strcmp(argv[i], "--bench-seeds") == 0 && i + 1 < argc) {
+            if (!ParseIntList(argv[++i], benchOptions.seeds)) {
+                fprintf(stderr, "Bad --bench-seeds list %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bench-sizes") == 0 && i + 1 < argc) {
+            // A maze needs at least two cells a side to generate
+            bool valid = ParseIntList(argv[++i], benchOptions.sizes);
+            for (int size : benchOptions.sizes) valid &= size >= 2;
+            if (!valid) {
+                fprintf(stderr, "Bad --bench-sizes list %s (sizes are integers of at least 2)\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--bench-frames") == 0 && i + 1 < argc) benchOptions.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bench-csv") == 0 && i + 1 < argc) benchOptions.csvPath = argv[++i];
+        else if (strcmp(argv[i], "--server") == 0) {
+            serverPort = SERVER_PORT;
+            if (i + 1 < argc && argv[i + 1][0] != '-' && !ParseInt(argv[++i], 1, 65535, serverPort)) {
+                fprintf(stderr, "Bad --server port %s (1 to 65535)\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--loopback-test") == 0 && i + 1 < argc) loopbackBots = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) connectAddress = argv[++i];
+        else if (strcmp(argv[i], "--rooms") == 0 && i + 1 < argc) roomCount = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc) {
+            botLoad = atoi(argv[++i]);
+            if (i + 1 < argc && argv[i + 1][0] != '-') botServer = argv[++i];
+        }
+        else if (strcmp(argv[i], "--room-threads") == 0 && i + 1 < argc) roomThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--room-seeds") == 0 && i + 1 < argc) roomSeeds = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--room-police") == 0 && i + 1 < argc) roomPolice = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--state-bench") == 0) {
+            stateBenchNpcs = 100000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') stateBenchNpcs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--snapshot-bench") == 0) {
+            snapshotBenchNpcs = 5000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') snapshotBenchNpcs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) serverSeed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--maze-size") == 0 && i + 1 < argc) {
+            // The WELCOME packet sends the size in 16 bits
+            if (!ParseInt(argv[++i], 2, 65535, serverMazeSize)) {
+                fprintf(stderr, "Bad --maze-size %s (2 to 65535)\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--npcs") == 0 && i + 1 < argc) {
+            if (!ParseInt(argv[++i], 0, INT_MAX, serverNpcs)) {
+                fprintf(stderr, "Bad --npcs %s (a count of 0 or more)\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            if (!ParseNumber(argv[++i], 0.0, HUGE_VAL, serverDuration)) {
+                fprintf(stderr, "Bad --duration %s (seconds, 0 or more)\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--no-interest") == 0) interestManagement = false;
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) link.latencyMs = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) link.jitterMs = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) link.lossPercent = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--no-prediction") == 0) usePrediction = false;
+        else if (strcmp(argv[i], "--autopilot") == 0) autopilot = true;
+        else if (strcmp(argv[i], "--squad") == 0 && i + 1 < argc) squadSize = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--path-bench") == 0) {
+            pathBenchSize = 512;
+            if (i + 1 < argc && argv[i + 1][0] != '-') pathBenchSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--hpa-bench") == 0) {
+            hierarchyBenchSize = 4096;
+            if (i + 1 < argc && argv[i + 1][0] != '-') hierarchyBenchSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--layout-bench") == 0) {
+            layoutBenchSize = 4096;
+            if (i + 1 < argc && argv[i + 1][0] != '-') layoutBenchSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--hugepage-bench") == 0) {
+            hugePageBenchSize = 4096;
+            if (i + 1 < argc && argv[i + 1][0] != '-') hugePageBenchSize = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--huge-pages") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            largePagePolicy.mode = LargePages::TRANSPARENT;
+            if (strcmp(mode, "off") == 0) largePagePolicy.mode = LargePages::OFF;
+            else if (strcmp(mode, "explicit") == 0) largePagePolicy.mode = LargePages::EXPLICIT;
+        }
+        else if (strcmp(argv[i], "--interleave-pages") == 0) interleavePages = true;
+        else if (strcmp(argv[i], "--fixed-bench") == 0) fixedBench = true;
+        else if (strcmp(argv[i], "--crowd-bench") == 0) {
+            crowdBenchAgents = 50000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') crowdBenchAgents = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--squad-bench") == 0) {
+            squadBenchPolice = 100;
+            if (i + 1 < argc && argv[i + 1][0] != '-') squadBenchPolice = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--bench-autopilot") == 0) benchOptions.autopilot = true;
+        else if (strcmp(argv[i], "--monte-carlo") == 0) {
+            monteCarloMatches = 1000;
+            if (i + 1 < argc && argv[i + 1][0] != '-') monteCarloMatches = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--mc-threads") == 0 && i + 1 < argc) monteCarloThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mc-csv") == 0 && i + 1 < argc) monteCarloCsv = argv[++i];
+        else if (strcmp(argv[i], "--mc-player-speed") == 0 && i + 1 < argc) sweepPlayerSpeed = ParseFloatList(argv[++i]);
+        else if (strcmp(argv[i], "--mc-bandit-speed") == 0 && i + 1 < argc) sweepBanditSpeed = ParseFloatList(argv[++i]);
+        else if (strcmp(argv[i], "--mc-flee") == 0 && i + 1 < argc) sweepFlee = ParseFloatList(argv[++i]);
+        else if (strcmp(argv[i], "--mc-chase") == 0 && i + 1 < argc) sweepChase = ParseFloatList(argv[++i]);
+        else if (strcmp(argv[i], "--alloc-test") == 0) {
+            allocTestSeconds = 30.0;
+            if (i + 1 < argc && argv[i + 1][0] != '-') allocTestSeconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--soak") == 0) {
+            soakSeconds = 600.0;
+            if (i + 1 < argc && argv[i + 1][0] != '-') soakSeconds = atof(argv[++i]);
+        }
+    }
+
+    // Large grids are first touched across a pool of their own, which
+    // outlives every mode below
+    std::unique_ptr<WorkerPool> pagePool;
+    if (interleavePages) {
+        pagePool = std::make_unique<WorkerPool>();
+        largePagePolicy.spread = [&pagePool](unsigned char* memory, size_t bytes) {
+            SpreadPages(*pagePool, memory, bytes);
+        };
+    }
+
+    if (benchmark) return RunBenchmark(benchOptions);
+    if (serverPort >= 0) {
+        return RunServer((uint16_t)serverPort, serverSeed, serverMazeSize, serverNpcs, serverDuration, interestManagement);
+    }
+    if (snapshotBenchNpcs > 0) return RunSnapshotBenchmark(snapshotBenchNpcs, serverMazeSize, 600);
+    if (stateBenchNpcs > 0) return RunStateBenchmark(stateBenchNpcs, serverMazeSize, 200);
+    if (soakSeconds > 0.0) return RunSoak(soakSeconds, serverSeed, serverMazeSize, serverNpcs);
+    if (allocTestSeconds > 0.0) return RunAllocationTest(allocTestSeconds, serverSeed, serverMazeSize, serverNpcs);
+    if (crowdBenchAgents > 0) return RunCrowdBenchmark(crowdBenchAgents, serverMazeSize, serverSeed);
+    if (pathBenchSize > 1) return RunPathBenchmark(pathBenchSize, serverSeed);
+    if (hierarchyBenchSize > 1) return RunHierarchyBenchmark(hierarchyBenchSize, serverSeed);
+    if (layoutBenchSize > 1) return RunLayoutBenchmark(layoutBenchSize, serverSeed);
+    if (hugePageBenchSize > 1) return RunHugePageBenchmark(hugePageBenchSize, serverSeed);
+    if (fixedBench) return RunFixedMazeBenchmark(serverSeed);
+    if (squadBenchPolice > 0) {
+        return RunSquadBenchmark(squadBenchPolice, serverNpcs, serverMazeSize,
+                                 serverDuration > 0.0 ? serverDuration : 30.0, serverSeed);
+    }
+    if (monteCarloMatches > 0) {
+        // Every combination of the swept values
+        std::vector<MatchConfig> configs;
+        for (float playerSpeed : sweepPlayerSpeed)
+            for (float banditSpeed : sweepBanditSpeed)
+                for (float flee : sweepFlee)
+                    for (float chase : sweepChase)
+                        configs.push_back({playerSpeed, banditSpeed, flee, chase});
+        return RunMonteCarlo(configs, monteCarloMatches, monteCarloThreads,
+                             serverDuration > 0.0 ? serverDuration : 120.0, serverSeed, serverMazeSize, serverNpcs,
+                             monteCarloCsv);
+    }
+    if (botLoad > 0) return RunBotLoad(botLoad, botServer, serverDuration > 0.0 ? serverDuration : 10.0, link);
+    if (roomCount > 0) {
+        return RunRoomBenchmark(roomCount, roomThreads, roomSeeds, serverMazeSize, serverNpcs, roomPolice,
+                                serverDuration > 0.0 ? serverDuration : 10.0);
+    }
+    if (loopbackBots > 0) {
+        return RunLoopbackTest(loopbackBots, serverDuration > 0.0 ? serverDuration : 10.0, serverMazeSize, serverNpcs,
+                               interestManagement, link);
+    }
+
+    // Online play: the server owns the world, this client sends inputs and
+    // shows the latest snapshot
+    FrameArena frameArena;
+    GameClient client;
+    client.frameArena = &frameArena;
+    bool online = false;
+    if (connectAddress) {
+        NetAddress address;
+        client.SetLinkConditions(link, (uint64_t)time(nullptr));
+        if (!ParseAddress(connectAddress, address) || !client.Open(address)) {
+            fprintf(stderr, "Could not connect to %s\n", connectAddress);
+            return 1;
+        }
+        online = true;
+    }
+    bool mazeFromServer = false;
+    uint32_t inputSequence = 0;
+    PlayerPrediction prediction;
+    double netAccumulator = 0.0;
+
     const int screenWidth = 800;
     const int screenHeight = 600;
 
     InitWindow(screenWidth, screenHeight, "Maze Explorer - Enhanced");
     DisableCursor();
 
+    // Textures decode in the background; the scene draws untextured until then
+    MaterialAtlas atlas;
+    atlas.BeginLoad();
+
+    // The local game lives in one arena: F5 saves it, F9 restores it and
+    // holding Backspace rewinds through the last REWIND_FRAMES frames
+    WorldState world;
+    world.Allocate(10, MAZE_WIDTH, MAZE_HEIGHT, squadSize);
     MazeGenerator maze;
+    world.BindMaze(maze);
+    maze.Seed((uint64_t)time(nullptr));
     maze.Initialize();
     maze.Generate();
 
-    Player player;
+    MazeMesh mazeMesh;
+    mazeMesh.Build(maze);
+    uint32_t meshRevision = world.GetHeader().mazeRevision;
+    // Rewind and restore roll the header's revision back, so new mazes take
+    // theirs from here and two different mazes never share one
+    uint32_t nextMazeRevision = meshRevision + 1;
+
+    Player& player = world.GetHeader().player;
     player.position = maze.GetRandomSpawnPosition();
+    for (int i = 0; i < squadSize; i++) world.GetPolice()[i].position = maze.GetRandomSpawnPosition();
 
     // Create NPCs
-    std::vector<NPC> npcs;
-    for (int i = 0; i < 10; i++) {
-        NPC npc;
+    NpcList npcs = world.GetNpcList();
+    for (NPC& npc : npcs) {
         npc.position = maze.GetRandomSpawnPosition();
         npc.target = maze.GetRandomSpawnPosition();
         npc.color = (Color){(unsigned char)(rand() % 200 + 55), 
                            (unsigned char)(rand() % 200 + 55), 
                            (unsigned char)(rand() % 200 + 55), 255};
-        npcs.push_back(npc);
     }
 
+    // Sized up front, so saving a frame never allocates
+    std::vector<std::vector<uint64_t>> rewindHistory(REWIND_FRAMES);
+    for (auto& snapshot : rewindHistory) world.Save(snapshot);
+    int rewindHead = 0;
+    int rewindCount = 0;
+    std::vector<uint64_t> quickSave;
+
     Camera3D camera = {0};
     camera.up = {0.0f, 1.0f, 0.0f};
     camera.fovy = 60.0f;
     camera.projection = CAMERA_PERSPECTIVE;
 
-    SetTargetFPS(60);
+    // CPU renderer (F2 toggles it, F12 saves the CPU framebuffer)
+    WorkerPool workerPool;
+    CpuRaycaster raycaster(workerPool);
+    raycaster.Resize(screenWidth, screenHeight);
+    Image blankFrame = GenImageColor(screenWidth, screenHeight, BLACK);
+    Texture2D cpuFrame = LoadTextureFromImage(blankFrame);
+    UnloadImage(blankFrame);
+    int savedFrames = 0;
+    float cpuRenderMs = 0.0f;
+
+    // Dynamic resolution (F3 toggles it)
+    dynamicRes.Load(screenWidth, screenHeight);
+
+    // Frame profiler (F1 shows the overlay, F4 toggles late latching)
+    FrameProfiler profiler;
+    KeyLatch keyLatch;
+
+    // Autopilot (F6 toggles it) steers the player after the nearest bandit,
+    // or by squad orders when there are AI officers (--squad)
+    PoliceAutopilot pilot;
+    CorridorGraph corridors;
+    corridors.Build(maze);
+    MazePathfinder pathfinder;
+    pathfinder.UseGraph(&corridors);
+    PoliceSquad squad(&workerPool);
+    CrowdSeparation crowd;
+
+    // The loop paces itself to FRAME_PERIOD_MS instead of SetTargetFPS, so
+    // EndDrawing returns right after the swap and work time excludes the sleep
+    SetTargetFPS(0);
 
     while (!WindowShouldClose()) {
+        auto frameStart = std::chrono::steady_clock::now();
+        frameArena.Reset();
+        profiler.BeginFrame();
         float deltaTime = GetFrameTime();
+        atlas.Update();
 
         // Mouse look
         Vector2 mouseDelta = GetMouseDelta();
+        profiler.MarkInput();
         player.yaw -= mouseDelta.x * MOUSE_SENSITIVITY;
         player.pitch -= mouseDelta.y * MOUSE_SENSITIVITY;
         
@@ -383,53 +7462,81 @@ int main() {
         if (player.pitch < -1.5f) player.pitch = -1.5f;
 
         // Movement
-        Vector3 forward = player.GetForward();
-        Vector3 right = player.GetRight();
-        
-        Vector3 moveForward = {forward.x, 0, forward.z};
-        moveForward = Vector3Normalize(moveForward);
-
-        Vector3 velocity = {0, 0, 0};
-
-        if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W)) {
-            velocity.x += moveForward.x * PLAYER_SPEED * deltaTime;
-            velocity.z += moveForward.z * PLAYER_SPEED * deltaTime;
-        }
-        if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S)) {
-            velocity.x -= moveForward.x * PLAYER_SPEED * deltaTime;
-            velocity.z -= moveForward.z * PLAYER_SPEED * deltaTime;
-        }
-        if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D)) {
-            velocity.x += right.x * PLAYER_SPEED * deltaTime;
-            velocity.z += right.z * PLAYER_SPEED * deltaTime;
-        }
-        if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A)) {
-            velocity.x -= right.x * PLAYER_SPEED * deltaTime;
-            velocity.z -= right.z * PLAYER_SPEED * deltaTime;
+        PlayerInput input;
+        input.yaw = player.yaw;
+        input.pitch = player.pitch;
+        input.buttons = ReadMovementButtons();
+        if (keyLatch.Pressed(KEY_F6)) autopilot = !autopilot;
+        if (autopilot && (!online || mazeFromServer)) {
+            input = squadSize > 0 && !online ? squad.Think(world, maze, 0)
+                                             : pilot.Think(maze, pathfinder, player.position, npcs);
+            player.yaw = input.yaw;
+            player.pitch = input.pitch;
         }
 
-        // Apply movement with collision
-        Vector3 newPosX = {player.position.x + velocity.x, player.position.y, player.position.z};
-        Vector3 newPosZ = {player.position.x, player.position.y, player.position.z + velocity.z};
-
-        if (!maze.CheckWallCollision(newPosX)) {
-            player.position.x = newPosX.x;
+        if (online) {
+            client.Update(GetTime());
+            if (client.connected && !mazeFromServer) {
+                // Same seed and size give the server's maze, which the
+                // server owns, so it leaves the local arena
+                maze.Unbind();
+                maze.Seed(client.mazeSeed);
+                maze.Initialize(client.mazeWidth, client.mazeHeight);
+                maze.Generate();
+                mazeMesh.Build(maze);
+                corridors.Build(maze);
+                mazeFromServer = true;
+            }
+            if (mazeFromServer) {
+                // Inputs go out once per server tick and are predicted with
+                // the tick's length, so replays match the server step for step
+                const float tickSeconds = 1.0f / client.tickRate;
+                netAccumulator = std::min(netAccumulator + deltaTime, 0.25);
+                while (netAccumulator >= tickSeconds) {
+                    netAccumulator -= tickSeconds;
+                    input.sequence = ++inputSequence;
+                    client.SendInput(input);
+                    prediction.Apply(maze, input, tickSeconds);
+                }
+                if (client.selfTick != 0) {
+                    prediction.Reconcile(maze, client.selfPosition, client.selfInput, client.selfTick, tickSeconds);
+                }
+                if (usePrediction && prediction.IsInitialized()) player.position = prediction.GetRenderPosition();
+                else if (const NetPlayer* self = client.FindPlayer(client.clientId)) player.position = self->position;
+            }
+            npcs = client.npcs;
+        }
+        else if (IsKeyDown(KEY_BACKSPACE) && rewindCount > 0) {
+            rewindHead = (rewindHead + REWIND_FRAMES - 1) % REWIND_FRAMES;
+            rewindCount--;
+            world.Restore(rewindHistory[rewindHead]);
+            squad.Reset();
         }
-        if (!maze.CheckWallCollision(newPosZ)) {
-            player.position.z = newPosZ.z;
+        else {
+            if (squadSize > 0) squad.Step(world, maze, input, deltaTime);
+            else StepWorld(world, maze, input, deltaTime, &crowd);
+            world.Save(rewindHistory[rewindHead]);
+            rewindHead = (rewindHead + 1) % REWIND_FRAMES;
+            rewindCount = std::min(rewindCount + 1, REWIND_FRAMES);
         }
 
-        // Update NPCs
-        for (auto& npc : npcs) {
-            npc.Think(maze, player.position, deltaTime);
-            npc.Update(maze, deltaTime);
+        if (!online) {
+            if (keyLatch.Pressed(KEY_F5)) world.Save(quickSave);
+            if (keyLatch.Pressed(KEY_F9) && !quickSave.empty()) {
+                world.Restore(quickSave);
+                squad.Reset();
+                rewindCount = 0;
+            }
         }
 
-        // Regenerate maze on R key
-        if (IsKeyPressed(KEY_R)) {
+        // Regenerate maze on R key (offline only)
+        if (keyLatch.Pressed(KEY_R) && !online) {
             maze.Initialize();
             maze.Generate();
+            world.GetHeader().mazeRevision = nextMazeRevision++;
+            squad.Reset();
             player.position = maze.GetRandomSpawnPosition();
+            for (int i = 0; i < squadSize; i++) world.GetPolice()[i].position = maze.GetRandomSpawnPosition();
             
             // Respawn NPCs
             for (auto& npc : npcs) {
@@ -438,26 +7545,81 @@ int main() {
             }
         }
 
+        // A restored or regenerated maze needs its mesh and graph rebuilt
+        if (!online && meshRevision != world.GetHeader().mazeRevision) {
+            mazeMesh.Build(maze);
+            corridors.Build(maze);
+            meshRevision = world.GetHeader().mazeRevision;
+        }
+
         // Update camera
         camera.position = {player.position.x, player.position.y + CAMERA_HEIGHT, player.position.z};
         camera.target = Vector3Add(camera.position, player.GetForward());
+        profiler.MarkSimEnd();
+
+        if (keyLatch.Pressed(KEY_F1)) profiler.showOverlay = !profiler.showOverlay;
+        if (keyLatch.Pressed(KEY_F2)) cpuRender = !cpuRender;
+        if (keyLatch.Pressed(KEY_F3)) dynamicRes.enabled = !dynamicRes.enabled;
+        if (keyLatch.Pressed(KEY_F4)) lateLatch = !lateLatch;
+        bool saveFrame = keyLatch.Pressed(KEY_F12);
+
+        // Late latch: poll again and apply mouse movement since the top of the
+        // frame to the camera only, just before rendering
+        if (lateLatch) {
+            PollInputEvents();
+            profiler.MarkLatch();
+            keyLatch.Capture();
+
+            Vector2 lateDelta = GetMouseDelta();
+            player.yaw -= lateDelta.x * MOUSE_SENSITIVITY;
+            player.pitch = Clamp(player.pitch - lateDelta.y * MOUSE_SENSITIVITY, -1.5f, 1.5f);
+            camera.target = Vector3Add(camera.position, player.GetForward());
+        }
+
+        int renderWidth = dynamicRes.GetRenderWidth();
+        int renderHeight = dynamicRes.GetRenderHeight();
+
+        if (cpuRender) {
+            auto renderStart = std::chrono::steady_clock::now();
+            raycaster.Resize(renderWidth, renderHeight);
+            raycaster.Render(maze, camera, npcs);
+            cpuRenderMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+            UpdateTextureRec(cpuFrame, {0, 0, (float)renderWidth, (float)renderHeight}, raycaster.GetPixels());
+
+            if (saveFrame || savedFrames < dumpFrames) {
+                raycaster.Export(TextFormat("cpu_frame_%03d.png", savedFrames++));
+            }
+        }
 
         BeginDrawing();
+            if (!cpuRender && dynamicRes.enabled) {
+                dynamicRes.BeginScene();
+                    ClearBackground(SKYBLUE);
+                    BeginMode3D(camera);
+                        DrawScene(mazeMesh, atlas, npcs);
+                        if (online) DrawPolice(client.players, client.clientId, atlas);
+                        else DrawPolice(world.GetPolice(), squadSize, atlas);
+                    EndMode3D();
+                dynamicRes.EndScene();
+            }
+
             ClearBackground(SKYBLUE);
 
-            BeginMode3D(camera);
-                // Draw maze
-                maze.Draw();
-                
-                // Draw floor
-                DrawPlane({(float)MAZE_WIDTH / 2 - 0.5f, 0, (float)MAZE_HEIGHT / 2 - 0.5f}, 
-                          {(float)MAZE_WIDTH, (float)MAZE_HEIGHT}, DARKGREEN);
-                
-                // Draw NPCs
-                for (auto& npc : npcs) {
-                    npc.Draw();
-                }
-            EndMode3D();
+            if (cpuRender) {
+                Rectangle source = {0, 0, (float)renderWidth, (float)renderHeight};
+                Rectangle dest = {0, 0, (float)screenWidth, (float)screenHeight};
+                DrawTexturePro(cpuFrame, source, dest, {0, 0}, 0.0f, WHITE);
+            }
+            else if (dynamicRes.enabled) {
+                dynamicRes.Present();
+            }
+            else {
+                BeginMode3D(camera);
+                    DrawScene(mazeMesh, atlas, npcs);
+                    if (online) DrawPolice(client.players, client.clientId, atlas);
+                    else DrawPolice(world.GetPolice(), squadSize, atlas);
+                EndMode3D();
+            }
 
             // Crosshair
             DrawLine(screenWidth/2 - 10, screenHeight/2, screenWidth/2 + 10, screenHeight/2, WHITE);
@@ -468,11 +7630,61 @@ int main() {
 
             // Controls
             DrawFPS(screenWidth - 100, 10);
+            if (cpuRender) {
+                DrawText(TextFormat("CPU raycaster: %.2f ms (%d threads)", cpuRenderMs, workerPool.GetThreadCount()),
+                         10, 10, 15, WHITE);
+            }
+            if (dynamicRes.enabled) {
+                DrawText(TextFormat("Render scale %.2f (%dx%d), work %.2f / %.2f ms", dynamicRes.GetScale(),
+                                    renderWidth, renderHeight, dynamicRes.GetSmoothedMs(), dynamicRes.targetFrameMs),
+                         10, 30, 15, WHITE);
+            }
+            if (online) {
+                DrawText(client.connected ? TextFormat("Online: id %d, %d police, tick %u", client.clientId,
+                                                       (int)client.players.size(), client.snapshotTick)
+                                          : TextFormat("Connecting to %s...", connectAddress),
+                         10, screenHeight - 25, 15, WHITE);
+            }
+            else {
+                DrawText(TextFormat("Arrests: %u%s", world.GetHeader().captures, autopilot ? " (autopilot)" : ""),
+                         10, screenHeight - 25, 15, WHITE);
+            }
+            if (profiler.showOverlay) {
+                profiler.DrawOverlay(10, 50, frameArena);
+            }
 
+            profiler.MarkSubmit();
         EndDrawing();
+        profiler.MarkSwap();
+
+        float workMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        dynamicRes.Feedback(workMs);
+        if (workMs < FRAME_PERIOD_MS) {
+            WaitTime((FRAME_PERIOD_MS - workMs) / 1000.0);
+        }
+    }
+
+    profiler.PrintReport(stdout);
+    PrintMemoryReport(stdout);
+    printf("Frame arena: peak %zu bytes of %zu KB\n", frameArena.PeakBytes(), frameArena.Capacity() / 1024);
+    if (latencyLog && profiler.WriteCsv(latencyLog)) {
+        printf("Frame timestamps written to %s\n", latencyLog);
+    }
+
+    if (online && !prediction.GetStats().corrections.empty()) {
+        std::vector<float> corrections = prediction.GetStats().corrections;
+        std::sort(corrections.begin(), corrections.end());
+        printf("Prediction: %zu reconciles, correction p50 %.4f, p99 %.4f, max %.4f units\n", corrections.size(),
+               corrections[corrections.size() / 2],
+               corrections[std::min(corrections.size() - 1, corrections.size() * 99 / 100)], corrections.back());
     }
 
     // Cleanup
+    if (online) client.Disconnect();
+    dynamicRes.Unload();
+    UnloadTexture(cpuFrame);
+    mazeMesh.Unload();
+    atlas.Unload();
     CloseWindow();
     return 0;
 }
\ No newline at end of file